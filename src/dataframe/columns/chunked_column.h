@@ -2,49 +2,157 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "../../ea2/kbstore.h"
 #include "../../utils/key.h"
 #include "../../utils/datastructures/element_column.h"
 
 /**
- * A column that will retrieve chunks of data from a KB store
+ * Deserializes a chunk of a column that was serialized with Column::serializeChunk
+ * @param type The type of the column
+ * @param deserializer The serialized chunk
+ * @param rows Set to the number of rows in the chunk
+ * @return The elements of the chunk. The caller owns them, and the strings in them
+ */
+inline Element* deserializeChunkOfType(char type, Deserializer& deserializer, uint64_t& rows) {
+    rows = deserializer.read_uint64();
+    Element* elements = new Element[rows];
+
+    for (size_t i = 0; i < rows; i++) {
+        if (type == STRING) {
+            elements[i].s = deserializer.read_string();
+        } else {
+            elements[i] = deserializer.read_element();
+        }
+    }
+
+    return elements;
+}
+
+/**
+ * A column that will retrieve chunks of data from a KB store. When the column is read in order, the chunks after the
+ * one being read are fetched in the background, so that a scan does not wait for a round trip at every chunk.
+ * Deserialized chunks are charged to the node's chunk budget, which may evict any chunk but the one being read. An
+ * evicted chunk is fetched again if it is read again
  * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
  */
-class ChunkedColumn {
+class ChunkedColumn: public ChunkBudget::Owner {
     public:
 
-        /** An ordered list of the keys for the individual chunks */
-        Key** _keys;
+        /**
+         * The version every read of a chunk expects. Chunks are never overwritten, so any copy of one in the KBStore's
+         * cache is current
+         */
+        static const uint64_t CHUNK_VERSION = 1;
+
+        /** The description of the dataframe, which the keys of the chunks are derived from. Shared by its columns */
+        std::shared_ptr<DataframeDescription> _description;
+
+        /**
+         * The newest description that chunks were read through. Starts out as _description, and is replaced when a chunk
+         * is no longer where it says, since an append or a rebalance replaced it and its old copies expired
+         */
+        std::shared_ptr<DataframeDescription> _latest;
+
+        /** The index of this column in the dataframe */
+        size_t _column;
 
         /** The number of chunks in the column */
         size_t _chunkCount;
 
+        /** The number of copies of each chunk */
+        size_t _replication;
+
+        /** The number of rows in every chunk but the last */
+        size_t _chunkRows;
+
         /** The cached chunks */
         Element** _chunks;
 
         /** The store to retrieve data from */
         KBStore& _kbstore;
 
+        /** How far along each chunk is in being loaded */
+        enum ChunkState : char { ABSENT, LOADING, LOADED };
+
+        /** The state of each chunk */
+        std::vector<ChunkState> _states;
+
+        /** Whether each chunk was read ahead and has not been used yet */
+        std::vector<bool> _wasReadAhead;
+
+        /** Mutex for _chunks, _states, _wasReadAhead, _reading and _latest while chunks are being read ahead */
+        std::mutex _mutex;
+
+        /** Signalled when a chunk is loaded, or a chunk that was read ahead is done with the column */
+        std::condition_variable _loaded;
+
+        /** The number of chunks of this column that the store's read ahead workers have not finished with */
+        size_t _reading = 0;
+
+        /** Passed as the last chunk before any chunk was read */
+        static const size_t NO_CHUNK = SIZE_MAX;
+
+        /** The chunk that was read last */
+        size_t _lastChunk = NO_CHUNK;
+
+        /** The elements of the chunk that was read last */
+        Element* _current = nullptr;
+
+        /** Whether each chunk is skipped by the filtered scan in progress. Skipped chunks are not read ahead */
+        std::vector<bool> _skipped;
+
         /**
-         * Creates a new column that will load chunks of data from different keys
-         * @param keys The list of keys to use for chunks
-         * @param chunkCount The number of chunks
+         * Creates a new column that will load chunks of data from the keys of a dataframe's description
+         * @param description The description of the dataframe
+         * @param column The index of this column in the dataframe
          * @param kbstore The kbstore to load the chunks from
          */
-        ChunkedColumn(Key **keys, size_t chunkCount, KBStore &kbstore) : _keys(keys), _chunkCount(chunkCount),
-                                                                         _kbstore(kbstore) {
+        ChunkedColumn(std::shared_ptr<DataframeDescription> description, size_t column, KBStore &kbstore) :
+            _description(description), _latest(description), _column(column), _chunkCount(description->chunks),
+            _replication(description->replication), _chunkRows(description->chunkRows), _kbstore(kbstore),
+            _states(_chunkCount, ABSENT), _wasReadAhead(_chunkCount, false) {
             _chunks = new Element*[_chunkCount];
             memset(_chunks, '\0', sizeof(Element*) * _chunkCount);
+
+            // The rows of a small dataframe are in its description, so its only chunk is never fetched or evicted
+            if (description->isInline()) { _loadInline(); }
         }
 
         virtual ~ChunkedColumn() {
+            _detach();
+
             for (size_t i = 0; i < _chunkCount; i++) {
                 delete[] _chunks[i];
-                delete _keys[i];
             }
 
             delete[] _chunks;
-            delete[] _keys;
+        }
+
+        /** Loads the only chunk of a dataframe whose rows are stored inside of its description */
+        void _loadInline() {
+            Deserializer deserializer(_description->inlined.size(), _description->inlined.data());
+            for (size_t column = 0; column <= _column; column++) {
+                uint64_t rows;
+                Element* elements = deserializeChunkOfType(_description->typeOf(column), deserializer, rows);
+
+                if (column == _column) {
+                    _chunks[0] = elements;
+                    _states[0] = LOADED;
+                    continue;
+                }
+
+                // The columns before this one are only read past
+                for (size_t i = 0; _description->typeOf(column) == STRING && i < rows; i++) {
+                    delete elements[i].s;
+                }
+
+                delete[] elements;
+            }
         }
 
         /**
@@ -54,27 +162,262 @@ class ChunkedColumn {
          */
         virtual Element* deserializeChunk(Deserializer& deserializer) = 0;
 
+        /**
+         * Frees a chunk that was deserialized
+         * @param chunk The index of the chunk
+         * @param elements The elements of the chunk
+         */
+        virtual void freeChunk(size_t chunk, Element* elements) { delete[] elements; }
+
         /**
          * Gets the element at the given index. If the chunk is not already loaded, it will be loaded from the KBStore
          * @param idx The index of the item to get
          * @return The element at the given index
          */
         Element _get(size_t idx) {
-            size_t chunk = idx / Column::CHUNK_SIZE;
-            if (!_chunks[chunk]) {
-                ByteArray* data = _kbstore.waitAndGet(*_keys[chunk]);
-                Deserializer deserializer(data->length, data->contents);
+            size_t chunk = idx / _chunkRows;
+            if (chunk != _lastChunk) {
+                // Moving on to the next chunk, or starting at the top of one, looks like a scan
+                bool sequential = (_lastChunk != NO_CHUNK && chunk == _lastChunk + 1) || idx % _chunkRows == 0;
+                _lastChunk = chunk;
+                _current = _load(chunk);
+
+                if (sequential) { _readAheadFrom(chunk + 1); }
+            }
+
+            return _current[idx % _chunkRows];
+        }
+
+        /**
+         * Provides a chunk, fetching it if it has not been and waiting for it if it is being read ahead
+         * @param chunk The index of the chunk
+         * @return The elements of the chunk
+         */
+        Element* _load(size_t chunk) {
+            // Pinned first so that the chunk can not be evicted once it is seen to be loaded
+            _kbstore.chunkBudget.pin(this, chunk);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_states[chunk] == ABSENT) {
+                _states[chunk] = LOADING;
+                lock.unlock();
+                size_t bytes;
+                Element* elements = _fetch(chunk, bytes);
+                lock.lock();
+
+                _chunks[chunk] = elements;
+                _states[chunk] = LOADED;
+                lock.unlock();
+
+                _kbstore.chunkBudget.add(this, chunk, bytes, true);
+                return elements;
+            }
+
+            if (_wasReadAhead[chunk]) {
+                _wasReadAhead[chunk] = false;
+                _kbstore.readAheadHits++;
+            }
+
+            _loaded.wait(lock, [&] { return _states[chunk] == LOADED; });
+            Element* elements = _chunks[chunk];
+            lock.unlock();
+
+            _kbstore.chunkBudget.touch(this, chunk);
+            return elements;
+        }
+
+        /**
+         * Fetches the chunks that a scan will read next in the background
+         * @param first The index of the first chunk to read ahead
+         */
+        void _readAheadFrom(size_t first) {
+            size_t ahead = _kbstore._readAhead;
+            std::vector<size_t> chunks;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (size_t chunk = first, upcoming = 0; upcoming < ahead && chunk < _chunkCount; chunk++) {
+                    if (chunk < _skipped.size() && _skipped[chunk]) { continue; }
+
+                    upcoming++;
+                    if (_states[chunk] != ABSENT) { continue; }
+
+                    _states[chunk] = LOADING;
+                    _wasReadAhead[chunk] = true;
+                    _reading++;
+                    chunks.push_back(chunk);
+                }
+            }
+
+            for (size_t chunk : chunks) {
+                _kbstore.readAheads++;
+                _kbstore.readAheadWorkers.submit([this, chunk] {
+                    size_t bytes;
+                    Element* elements = _fetch(chunk, bytes);
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _chunks[chunk] = elements;
+                        _states[chunk] = LOADED;
+                    }
+
+                    _loaded.notify_all();
+                    _kbstore.chunkBudget.add(this, chunk, bytes, false);
+
+                    // Notified under the lock, since the column may be destroyed as soon as the lock is released
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _reading--;
+                    _loaded.notify_all();
+                });
+            }
+        }
 
-                _chunks[chunk] = deserializeChunk(deserializer);
-                delete data;
+        /**
+         * Fetches a chunk from one of its copies and deserializes it. A chunk that is not where the description says is
+         * read through the newest description instead, and waited for if that does not have it either
+         * @param chunk The index of the chunk
+         * @param bytes Set to the number of bytes the chunk is charged to the budget. The serialized size is used,
+         *              which is close to the deserialized size
+         * @return The elements of the chunk
+         */
+        Element* _fetch(size_t chunk, size_t& bytes) {
+            std::shared_ptr<DataframeDescription> latest = _latestDescription();
+            ByteArray* data = _fetchThrough(*latest, chunk, false);
+
+            // The description is read again only once. A chunk that the newest description does not have either is
+            // still being put, so it is waited for instead of looked for again
+            if (!data) {
+                _refresh(*latest, chunk);
+                data = _fetchThrough(*_latestDescription(), chunk, true);
+            }
+
+            Deserializer deserializer(data->length, data->contents);
+
+            Element* elements = deserializeChunk(deserializer);
+            bytes = data->length;
+            delete data;
+            return elements;
+        }
+
+        /**
+         * Reads a chunk from one of the copies that a description says it has
+         * @param description The description to derive the keys of the copies from
+         * @param chunk The index of the chunk
+         * @param wait Whether to block until the chunk exists
+         * @return The serialized chunk, or nullptr if it does not exist and wait is false
+         */
+        ByteArray* _fetchThrough(DataframeDescription& description, size_t chunk, bool wait) {
+            std::vector<Key*> copies(_replication);
+            std::vector<uint64_t> versions(_replication, (uint64_t)CHUNK_VERSION);
+            for (size_t copy = 0; copy < _replication; copy++) {
+                copies[copy] = description.keyFor(_column, chunk, copy);
+            }
+
+            ByteArray* data = wait ? _kbstore.waitAndGet(copies.data(), versions.data(), _replication)
+                                   : _kbstore.get(copies.data(), versions.data(), _replication);
+            for (Key* copy : copies) {
+                delete copy;
             }
 
-            return _chunks[chunk][idx % Column::CHUNK_SIZE];
+            return data;
         }
 
-        /** Determines if the given key is locally stored on this machine */
-        bool isKeyLocal(Key* key) {
-            return key->getNode() == _kbstore.this_node();
+        /**
+         * Provides the newest description that chunks were read through
+         * @return The description
+         */
+        std::shared_ptr<DataframeDescription> _latestDescription() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _latest;
+        }
+
+        /**
+         * Reads the description of the dataframe again if it changed since the one that chunks were read through. The
+         * rows of every chunk an append leaves in place stay the same, and a rebalance only moves chunks, so a newer
+         * description that cuts the rows into chunks the same way has the same rows in the chunk
+         * @param latest The description that chunks were read through
+         * @param chunk The index of the chunk that was not found
+         * @return true if a newer description that has the chunk was read
+         */
+        bool _refresh(DataframeDescription& latest, size_t chunk) {
+            Key* key = latest.key();
+            ByteArray* bytes = _kbstore.getIfNewer(*key, latest.version);
+            delete key;
+            if (!bytes) { return false; }
+
+            std::shared_ptr<DataframeDescription> newer = std::make_shared<DataframeDescription>();
+            Deserializer deserializer(bytes->length, bytes->contents);
+            newer->deserialize(deserializer);
+            newer->version = bytes->version;
+            delete bytes;
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            // Another read of a chunk may have replaced the description first
+            if (_latest->version < newer->version && !newer->isInline() && newer->chunkRows == _chunkRows
+                && newer->replication == _replication && chunk < newer->chunks) {
+                _latest = newer;
+                return true;
+            }
+
+            return false;
+        }
+
+        /**
+         * Takes a chunk that was fetched along with the description, so that reading it does not go over the network
+         * @param chunk The index of the chunk
+         * @param deserializer The serialized chunk
+         * @param bytes The number of bytes the chunk is charged to the budget
+         */
+        void _preload(size_t chunk, Deserializer& deserializer, size_t bytes) {
+            Element* elements = deserializeChunk(deserializer);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_states[chunk] != ABSENT) {
+                    freeChunk(chunk, elements);
+                    return;
+                }
+
+                _chunks[chunk] = elements;
+                _states[chunk] = LOADED;
+            }
+
+            _kbstore.chunkBudget.add(this, chunk, bytes, false);
+        }
+
+        /**
+         * Frees a chunk to stay within the node's chunk budget. Chunks that are still being read ahead are left alone
+         * since they are not charged yet
+         * @param chunk The index of the chunk
+         */
+        void evict(size_t chunk) override {
+            Element* elements;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_states[chunk] != LOADED) { return; }
+
+                elements = _chunks[chunk];
+                _chunks[chunk] = nullptr;
+                _states[chunk] = ABSENT;
+                _wasReadAhead[chunk] = false;
+            }
+
+            freeChunk(chunk, elements);
+        }
+
+        /**
+         * Waits for the chunks that are being read ahead and stops charging the chunks to the budget. Called by the
+         * destructor of every concrete column, since the chunks are deserialized and freed through it
+         */
+        void _detach() {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _loaded.wait(lock, [&] { return _reading == 0; });
+            }
+
+            _kbstore.chunkBudget.remove(this);
+        }
+
+        /** Determines if the home copy of the given chunk is stored on this machine */
+        bool isChunkLocal(size_t chunk) {
+            return _description->nodeOf(chunk, 0) == _kbstore.this_node();
         }
 
 };
@@ -88,12 +431,12 @@ class ChunkedRawElementColumn: public ChunkedColumn {
     public:
 
         /**
-         * Creates a new column that will load chunks of data from different keys
-         * @param keys The list of keys to use for chunks
-         * @param chunkCount The number of chunks
+         * Creates a new column that will load chunks of data from the keys of a dataframe's description
+         * @param description The description of the dataframe
+         * @param column The index of this column in the dataframe
          * @param kbstore The kbstore to load the chunks from
          */
-        ChunkedRawElementColumn(Key **keys, size_t chunkCount, KBStore &kbstore) : ChunkedColumn(keys, chunkCount, kbstore) {}
+        ChunkedRawElementColumn(std::shared_ptr<DataframeDescription> description, size_t column, KBStore &kbstore) : ChunkedColumn(description, column, kbstore) {}
 
         /**
          * Deserializes a single chunk that was loaded from the KBStore
@@ -101,14 +444,8 @@ class ChunkedRawElementColumn: public ChunkedColumn {
          * @return The deserialized chunk
          */
         virtual Element* deserializeChunk(Deserializer &deserializer) {
-            uint64_t size = deserializer.read_uint64();
-            Element* elements = new Element[size];
-
-            for (size_t i = 0; i < size; i++) {
-                elements[i] = deserializer.read_element();
-            }
-
-            return elements;
+            uint64_t rows;
+            return deserializeChunkOfType(INT, deserializer, rows);
         }
 
 };
@@ -125,15 +462,16 @@ class ChunkedIntColumn: public ChunkedRawElementColumn, public IntColumn {
         size_t _totalSize;
 
         /**
-         * Creates a new column that will load chunks of data from different keys
-         * @param keys The list of keys to use for chunks
-         * @param chunkCount The number of chunks
+         * Creates a new column that will load chunks of data from the keys of a dataframe's description
+         * @param description The description of the dataframe
+         * @param column The index of this column in the dataframe
          * @param kbstore The kbstore to load the chunks from
-         * @param totalSize The number of elements inside of the entire column
          */
-        ChunkedIntColumn(Key **keys, size_t chunkCount, KBStore &kbstore, size_t totalSize) :
-            ChunkedRawElementColumn(keys, chunkCount,kbstore),
-            _totalSize(totalSize) {}
+        ChunkedIntColumn(std::shared_ptr<DataframeDescription> description, size_t column, KBStore &kbstore) :
+            ChunkedRawElementColumn(description, column, kbstore),
+            _totalSize(description->rows) {}
+
+        virtual ~ChunkedIntColumn() { _detach(); }
 
         /**
          * Returns the element at the given index
@@ -170,15 +508,16 @@ class ChunkedBoolColumn: public ChunkedRawElementColumn, public BoolColumn {
         size_t _totalSize;
 
         /**
-         * Creates a new column that will load chunks of data from different keys
-         * @param keys The list of keys to use for chunks
-         * @param chunkCount The number of chunks
+         * Creates a new column that will load chunks of data from the keys of a dataframe's description
+         * @param description The description of the dataframe
+         * @param column The index of this column in the dataframe
          * @param kbstore The kbstore to load the chunks from
-         * @param totalSize The number of elements inside of the entire column
          */
-        ChunkedBoolColumn(Key **keys, size_t chunkCount, KBStore &kbstore, size_t totalSize) :
-                ChunkedRawElementColumn(keys, chunkCount,kbstore),
-                _totalSize(totalSize) {}
+        ChunkedBoolColumn(std::shared_ptr<DataframeDescription> description, size_t column, KBStore &kbstore) :
+                ChunkedRawElementColumn(description, column, kbstore),
+                _totalSize(description->rows) {}
+
+        virtual ~ChunkedBoolColumn() { _detach(); }
 
         /**
          * Returns the element at the given index
@@ -215,15 +554,16 @@ class ChunkedDoubleColumn: public ChunkedRawElementColumn, public DoubleColumn {
         size_t _totalSize;
 
         /**
-         * Creates a new column that will load chunks of data from different keys
-         * @param keys The list of keys to use for chunks
-         * @param chunkCount The number of chunks
+         * Creates a new column that will load chunks of data from the keys of a dataframe's description
+         * @param description The description of the dataframe
+         * @param column The index of this column in the dataframe
          * @param kbstore The kbstore to load the chunks from
-         * @param totalSize The number of elements inside of the entire column
          */
-        ChunkedDoubleColumn(Key **keys, size_t chunkCount, KBStore &kbstore, size_t totalSize) :
-                ChunkedRawElementColumn(keys, chunkCount,kbstore),
-                _totalSize(totalSize) {}
+        ChunkedDoubleColumn(std::shared_ptr<DataframeDescription> description, size_t column, KBStore &kbstore) :
+                ChunkedRawElementColumn(description, column, kbstore),
+                _totalSize(description->rows) {}
+
+        virtual ~ChunkedDoubleColumn() { _detach(); }
 
         /**
          * Returns the element at the given index
@@ -255,26 +595,39 @@ class ChunkedStringColumn: public ChunkedColumn, public StringColumn {
         size_t _totalSize;
 
         /**
-         * Creates a new column that will load chunks of data from different keys
-         * @param keys The list of keys to use for chunks
-         * @param chunkCount The number of chunks
+         * Creates a new column that will load chunks of data from the keys of a dataframe's description
+         * @param description The description of the dataframe
+         * @param column The index of this column in the dataframe
          * @param kbstore The kbstore to load the chunks from
-         * @param totalSize The number of elements inside of the entire column
          */
-        ChunkedStringColumn(Key **keys, size_t chunkCount, KBStore &kbstore, size_t totalSize) :
-            ChunkedColumn(keys, chunkCount,kbstore),
-            _totalSize(totalSize) {}
+        ChunkedStringColumn(std::shared_ptr<DataframeDescription> description, size_t column, KBStore &kbstore) :
+            ChunkedColumn(description, column, kbstore),
+            _totalSize(description->rows) {}
 
         virtual ~ChunkedStringColumn() {
+            _detach();
+
             for (size_t i = 0; i < _chunkCount; i++) {
                 if (_chunks[i]) {
-                    for (size_t idx = 0; idx < CHUNK_SIZE && i * CHUNK_SIZE + idx < _totalSize; idx++) {
-                        delete _chunks[i][idx].s;
-                    }
+                    freeChunk(i, _chunks[i]);
+                    _chunks[i] = nullptr;
                 }
             }
         }
 
+        /**
+         * Frees a chunk that was deserialized, along with its strings
+         * @param chunk The index of the chunk
+         * @param elements The elements of the chunk
+         */
+        void freeChunk(size_t chunk, Element* elements) override {
+            for (size_t idx = 0; idx < _chunkRows && chunk * _chunkRows + idx < _totalSize; idx++) {
+                delete elements[idx].s;
+            }
+
+            delete[] elements;
+        }
+
         virtual String* get(size_t idx) { return _get(idx).s; }
 
         /**
@@ -298,14 +651,8 @@ class ChunkedStringColumn: public ChunkedColumn, public StringColumn {
          * @return The deserialized chunk
          */
         Element *deserializeChunk(Deserializer &deserializer) override {
-            uint64_t size = deserializer.read_uint64();
-            Element* elements = new Element[size];
-
-            for (size_t i = 0; i < size; i++) {
-                elements[i].s = deserializer.read_string();
-            }
-
-            return elements;
+            uint64_t rows;
+            return deserializeChunkOfType(STRING, deserializer, rows);
         }
 
 };
\ No newline at end of file
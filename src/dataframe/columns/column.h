@@ -1,5 +1,7 @@
 #pragma once
 
+#include "../../utils/zone_map.h"
+
 class IntColumn;
 class BoolColumn;
 class DoubleColumn;
@@ -16,9 +18,21 @@ class StringColumn;
 class Column : public Object {
     public:
 
-        /** The number of elements in one chunk */
+        /** The most elements in one chunk */
         static const size_t CHUNK_SIZE = 2500000;
 
+        /** The most bytes the serialized chunk of a single column should take up */
+        static const size_t MAX_CHUNK_BYTES = CHUNK_SIZE * 8;
+
+        /** The fewest rows that a dataframe is split into chunks of, since every chunk costs a request to read */
+        static const size_t MIN_CHUNK_ROWS = 4096;
+
+        /** The number of chunks that each node gets of a dataframe that is spread over the cluster */
+        static const size_t CHUNKS_PER_NODE = 2;
+
+        /** The number of bytes a string is expected to serialize to, including its length */
+        static const size_t STRING_WIDTH = 32;
+
         virtual ~Column() {}
 
         /** Type converters: Return same column under its actual type, or
@@ -41,15 +55,59 @@ class Column : public Object {
         /** Return the type of this column as a char: 'S', 'B', 'I' and 'F'. */
         virtual char get_type() { return '\0'; }
 
-        /** Returns the number of chunks inside of this column */
-        size_t numChunks() { return size() / CHUNK_SIZE + (size() % CHUNK_SIZE ? 1 : 0); }
+        /**
+         * Returns the number of chunks inside of this column
+         * @param chunkRows The number of rows in every chunk but the last
+         */
+        size_t numChunks(size_t chunkRows) { return size() / chunkRows + (size() % chunkRows ? 1 : 0); }
 
         /**
          * Serializes a single chunk
          * @param serializer The serializer to serialize the chunk into
          * @param idx The index of the chunk to serialize
+         * @param chunkRows The number of rows in every chunk but the last
+         */
+        virtual void serializeChunk(Serializer& serializer, size_t idx, size_t chunkRows) { /** By default do nothing */ }
+
+        /**
+         * Summarizes the values of a single chunk so that scans can rule it out without reading it
+         * @param idx The index of the chunk to summarize
+         * @param chunkRows The number of rows in every chunk but the last
+         * @return The zone map of the chunk. By default one that rules nothing out
+         */
+        virtual ZoneMap zoneMapOf(size_t idx, size_t chunkRows) { return ZoneMap(); }
+
+        /**
+         * Provides the most rows a chunk of a dataframe with the given schema can have without the chunk of its
+         * widest column growing larger than MAX_CHUNK_BYTES
+         * @param types The types of the columns
+         */
+        static size_t maxChunkRows(const char* types) {
+            size_t width = 8;
+            for (const char* type = types; *type; type++) {
+                if (*type == 'S' && STRING_WIDTH > width) { width = STRING_WIDTH; }
+            }
+
+            size_t rows = MAX_CHUNK_BYTES / width;
+            return rows < CHUNK_SIZE ? rows : CHUNK_SIZE;
+        }
+
+        /**
+         * Picks the number of rows in each chunk of a dataframe. Dataframes are spread out so that every node gets
+         * CHUNKS_PER_NODE chunks, unless that would make chunks smaller than MIN_CHUNK_ROWS or larger than
+         * maxChunkRows
+         * @param rows The number of rows that the dataframe is expected to have
+         * @param types The types of the columns
+         * @param nodes The number of nodes in the cluster
          */
-        virtual void serializeChunk(Serializer& serializer, size_t idx) { /** By default do nothing */ }
+        static size_t chunkRowsFor(size_t rows, const char* types, size_t nodes) {
+            size_t chunks = (nodes ? nodes : 1) * CHUNKS_PER_NODE;
+            size_t chunkRows = rows / chunks + (rows % chunks ? 1 : 0);
+            size_t maxRows = maxChunkRows(types);
+
+            if (chunkRows > maxRows) { return maxRows; }
+            return chunkRows < MIN_CHUNK_ROWS ? MIN_CHUNK_ROWS : chunkRows;
+        }
 
 };
 
@@ -10,26 +10,49 @@
  * Returns the number of elements inside the given chunk
  * @param idx The index of the chunk
  * @param totalSize The length of the entire column
+ * @param chunkRows The number of elements in every chunk but the last
  */
-inline uint64_t chunkSize(size_t idx, size_t totalSize) {
-    size_t remainingElements = totalSize - (Column::CHUNK_SIZE * idx);
-    return remainingElements >= Column::CHUNK_SIZE ? Column::CHUNK_SIZE : remainingElements;
+inline uint64_t chunkSize(size_t idx, size_t totalSize, size_t chunkRows) {
+    size_t remainingElements = totalSize - (chunkRows * idx);
+    return remainingElements >= chunkRows ? chunkRows : remainingElements;
 }
 
 /**
  * Serializes a single chunk using the raw elements
  * @param serializer The serializer to serialize the chunk into
  * @param idx The index of the chunk to serialize
+ * @param chunkRows The number of elements in every chunk but the last
+ * @param column The elements to serialize
  */
-inline void serializeChunkRawElement(Serializer& serializer, size_t idx, ElementColumn& column) {
-    uint64_t elements = chunkSize(idx, column.size());
+inline void serializeChunkRawElement(Serializer& serializer, size_t idx, size_t chunkRows, ElementColumn& column) {
+    uint64_t elements = chunkSize(idx, column.size(), chunkRows);
 
+    serializer.reserve(sizeof(uint64_t) + sizeof(Element) * elements);
     serializer.write(elements);
-    for (size_t i = 0; i < elements && idx * Column::CHUNK_SIZE + i < column.size(); i++) {
-        serializer.write(*column.get(idx * Column::CHUNK_SIZE + i));
+    for (size_t i = 0; i < elements && idx * chunkRows + i < column.size(); i++) {
+        serializer.write(*column.get(idx * chunkRows + i));
     }
 }
 
+/**
+ * Summarizes a single chunk of raw elements by their smallest and largest value
+ * @param idx The index of the chunk to summarize
+ * @param chunkRows The number of elements in every chunk but the last
+ * @param column The elements to summarize
+ * @param value Provides the value of an element
+ */
+template <typename F>
+inline ZoneMap zoneMapOfRawElement(size_t idx, size_t chunkRows, ElementColumn& column, F value) {
+    uint64_t elements = chunkSize(idx, column.size(), chunkRows);
+
+    ZoneMap zoneMap = ZoneMap::empty();
+    for (size_t i = 0; i < elements; i++) {
+        zoneMap.add(value(*column.get(idx * chunkRows + i)));
+    }
+
+    return zoneMap;
+}
+
 /*************************************************************************
 * IntColumn::
 * Holds int values.
@@ -97,9 +120,19 @@ class FullIntColumn : public IntColumn {
          * Serialize a single chunk
          * @param serializer The serializer to serialize into
          * @param idx The index of the chunk to serialze
+         * @param chunkRows The number of rows in every chunk but the last
          */
-        virtual void serializeChunk(Serializer &serializer, size_t idx) {
-            serializeChunkRawElement(serializer, idx, _elements);
+        virtual void serializeChunk(Serializer &serializer, size_t idx, size_t chunkRows) {
+            serializeChunkRawElement(serializer, idx, chunkRows, _elements);
+        }
+
+        /**
+         * Summarizes a single chunk
+         * @param idx The index of the chunk to summarize
+         * @param chunkRows The number of rows in every chunk but the last
+         */
+        ZoneMap zoneMapOf(size_t idx, size_t chunkRows) override {
+            return zoneMapOfRawElement(idx, chunkRows, _elements, [](Element element) { return (double)element.i; });
         }
 
 };
@@ -171,9 +204,28 @@ class FullBoolColumn : public BoolColumn {
          * Serialize a single chunk
          * @param serializer The serializer to serialize into
          * @param idx The index of the chunk to serialze
+         * @param chunkRows The number of rows in every chunk but the last
+         */
+        virtual void serializeChunk(Serializer &serializer, size_t idx, size_t chunkRows) {
+            serializeChunkRawElement(serializer, idx, chunkRows, _elements);
+        }
+
+        /**
+         * Summarizes a single chunk
+         * @param idx The index of the chunk to summarize
+         * @param chunkRows The number of rows in every chunk but the last
          */
-        virtual void serializeChunk(Serializer &serializer, size_t idx) {
-            serializeChunkRawElement(serializer, idx, _elements);
+        ZoneMap zoneMapOf(size_t idx, size_t chunkRows) override {
+            uint64_t elements = chunkSize(idx, size(), chunkRows);
+
+            ZoneMap zoneMap;
+            for (size_t i = 0; i < elements; i++) {
+                if (_elements.get(idx * chunkRows + i)->b) { zoneMap.trues++; }
+            }
+
+            zoneMap.min = zoneMap.trues == elements ? 1 : 0;
+            zoneMap.max = zoneMap.trues ? 1 : 0;
+            return zoneMap;
         }
 
 };
@@ -245,9 +297,19 @@ class FullDoubleColumn : public DoubleColumn {
          * Serialize a single chunk
          * @param serializer The serializer to serialize into
          * @param idx The index of the chunk to serialze
+         * @param chunkRows The number of rows in every chunk but the last
+         */
+        virtual void serializeChunk(Serializer &serializer, size_t idx, size_t chunkRows) {
+            serializeChunkRawElement(serializer, idx, chunkRows, _elements);
+        }
+
+        /**
+         * Summarizes a single chunk
+         * @param idx The index of the chunk to summarize
+         * @param chunkRows The number of rows in every chunk but the last
          */
-        virtual void serializeChunk(Serializer &serializer, size_t idx) {
-            serializeChunkRawElement(serializer, idx, _elements);
+        ZoneMap zoneMapOf(size_t idx, size_t chunkRows) override {
+            return zoneMapOfRawElement(idx, chunkRows, _elements, [](Element element) { return element.f; });
         }
 
 };
@@ -327,13 +389,28 @@ class FullStringColumn : public StringColumn {
          * Serialize a single chunk
          * @param serializer The serializer to serialize into
          * @param idx The index of the chunk to serialze
+         * @param chunkRows The number of rows in every chunk but the last
          */
-        void serializeChunk(Serializer &serializer, size_t idx) override {
-            uint64_t elements = chunkSize(idx, _elements.size());
+        void serializeChunk(Serializer &serializer, size_t idx, size_t chunkRows) override {
+            uint64_t elements = chunkSize(idx, _elements.size(), chunkRows);
 
             serializer.write(elements);
-            for (size_t i = 0; i < elements && idx * Column::CHUNK_SIZE + i < size(); i++) {
-                serializer.write(_elements.get(idx * Column::CHUNK_SIZE + i)->s);
+            for (size_t i = 0; i < elements && idx * chunkRows + i < size(); i++) {
+                serializer.write(_elements.get(idx * chunkRows + i)->s);
             }
         }
+
+        /**
+         * Summarizes a single chunk
+         * @param idx The index of the chunk to summarize
+         * @param chunkRows The number of rows in every chunk but the last
+         */
+        ZoneMap zoneMapOf(size_t idx, size_t chunkRows) override {
+            ZoneMap zoneMap;
+            for (size_t i = 0; i < chunkSize(idx, size(), chunkRows); i++) {
+                if (!_elements.get(idx * chunkRows + i)->s) { zoneMap.nulls++; }
+            }
+
+            return zoneMap;
+        }
 };
\ No newline at end of file
@@ -1,16 +1,27 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdarg>
+#include <deque>
 #include <thread>
 #include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "../utils/column_type.h"
 #include "../utils/instructor-provided/object.h"
 #include "../utils/datastructures/element_column.h"
 #include "../utils/instructor-provided/string.h"
 #include "../ea2/kvstore/kvstore.h"
+#include "../utils/workers.h"
 #include "../network/shared/messages.h"
 #include "columns/concrete_columns.h"
 #include "columns/chunked_column.h"
@@ -33,19 +44,19 @@ inline Column* allocateColumnOfType(char type) {
 }
 
 /**
- * Creates a new column that will load chunks of data from different keys of the given type
+ * Creates a new column of the given type that will load chunks of data from the keys of a dataframe's description
  * @param type The type of column to create
- * @param keys The list of keys to use for chunks
- * @param chunkCount The number of chunks
+ * @param description The description of the dataframe
+ * @param column The index of the column in the dataframe
  * @param kbstore The kbstore to load the chunks from
- * @param totalSize The number of elements inside of the entire column
  */
-inline Column* allocateChunkedColumnOfType(char type, Key** keys, size_t chunkCount, KBStore &kbstore, size_t totalSize) {
+inline Column* allocateChunkedColumnOfType(char type, std::shared_ptr<DataframeDescription> description, size_t column,
+                                           KBStore &kbstore) {
     switch (type) {
-        case INT: return new ChunkedIntColumn(keys, chunkCount, kbstore, totalSize);
-        case BOOL: return new ChunkedBoolColumn(keys, chunkCount, kbstore, totalSize);
-        case DOUBLE: return new ChunkedDoubleColumn(keys, chunkCount, kbstore, totalSize);
-        case STRING: return new ChunkedStringColumn(keys, chunkCount, kbstore, totalSize);
+        case INT: return new ChunkedIntColumn(description, column, kbstore);
+        case BOOL: return new ChunkedBoolColumn(description, column, kbstore);
+        case DOUBLE: return new ChunkedDoubleColumn(description, column, kbstore);
+        case STRING: return new ChunkedStringColumn(description, column, kbstore);
         default: return nullptr;
     }
 }
@@ -72,10 +83,257 @@ public:
  */
 class Reader {
 public:
+    virtual ~Reader() {}
+
     /** Reads the next word */
     virtual bool visit(Row & r) { return false; }
 };
 
+/**
+ * The kinds of predicates that can be sent to the nodes that store the chunks of a dataframe
+ */
+enum PredicateType: uint8_t {
+    RANGE_PREDICATE,
+    STRING_EQUALS_PREDICATE
+};
+
+/**
+ * A condition on the rows of a dataframe. Filtered scans only visit the rows that match it, and skip every chunk that
+ * the zone maps in the dataframe's description show can not contain a match. Predicates that can be serialized are
+ * evaluated on the home node of every chunk, so only the matching rows are sent back
+ * Written by ng.h@husky.neu.edu & pazol.l@husky.neu.edu
+ */
+class Predicate {
+public:
+    virtual ~Predicate() {}
+
+    /** Determines whether a row matches */
+    virtual bool matches(Row& r) = 0;
+
+    /**
+     * Determines whether any row of a chunk may match without reading the chunk
+     * @param description The description of the dataframe
+     * @param chunk The index of the chunk
+     * @return false only if no row of the chunk can match
+     */
+    virtual bool mayMatch(DataframeDescription& description, size_t chunk) { return true; }
+
+    /**
+     * Writes the predicate out so that it can be evaluated on the nodes that store the chunks
+     * @param serializer The serializer to write the predicate with
+     * @return false if the predicate can only be evaluated on this node
+     */
+    virtual bool serialize(Serializer& serializer) { return false; }
+
+    /**
+     * Reads a predicate that was written out with serialize
+     * @param deserializer The buffer to read from
+     * @return The predicate. The caller owns it
+     */
+    static Predicate* deserialize(Deserializer& deserializer);
+};
+
+/**
+ * Matches the rows whose value in a column is within a range, bounds included. The column must hold ints, bools or
+ * doubles, with false as 0 and true as 1. Chunks of a column that is sorted or clustered by the value are mostly ruled
+ * out by their zone maps
+ * Written by ng.h@husky.neu.edu & pazol.l@husky.neu.edu
+ */
+class RangePredicate : public Predicate {
+public:
+
+    /** The index of the column */
+    size_t _column;
+
+    /** The smallest value that matches */
+    double _low;
+
+    /** The largest value that matches */
+    double _high;
+
+    /**
+     * Default constructor
+     * @param column The index of the column
+     * @param low The smallest value that matches
+     * @param high The largest value that matches
+     */
+    RangePredicate(size_t column, double low, double high) : _column(column), _low(low), _high(high) {}
+
+    bool matches(Row& r) override {
+        double value;
+        switch (r.col_type(_column)) {
+            case INT: value = r.get_int(_column); break;
+            case BOOL: value = r.get_bool(_column) ? 1 : 0; break;
+            case DOUBLE: value = r.get_double(_column); break;
+            default: return false;
+        }
+
+        return value >= _low && value <= _high;
+    }
+
+    bool mayMatch(DataframeDescription& description, size_t chunk) override {
+        return description.zoneMapOf(_column, chunk).overlaps(_low, _high);
+    }
+
+    bool serialize(Serializer& serializer) override {
+        serializer.write((uint8_t)RANGE_PREDICATE);
+        serializer.write((uint64_t)_column);
+        serializer.write(_low);
+        serializer.write(_high);
+        return true;
+    }
+
+    /** Matches the rows whose value in a column is less than a value */
+    static RangePredicate lessThan(size_t column, double value) { return RangePredicate(column, -HUGE_VAL, std::nextafter(value, -HUGE_VAL)); }
+
+    /** Matches the rows whose value in a column is at most a value */
+    static RangePredicate atMost(size_t column, double value) { return RangePredicate(column, -HUGE_VAL, value); }
+
+    /** Matches the rows whose value in a column is equal to a value */
+    static RangePredicate equalTo(size_t column, double value) { return RangePredicate(column, value, value); }
+
+    /** Matches the rows whose value in a column is at least a value */
+    static RangePredicate atLeast(size_t column, double value) { return RangePredicate(column, value, HUGE_VAL); }
+
+    /** Matches the rows whose value in a column is greater than a value */
+    static RangePredicate greaterThan(size_t column, double value) { return RangePredicate(column, std::nextafter(value, HUGE_VAL), HUGE_VAL); }
+};
+
+/**
+ * Matches the rows whose string in a column is equal to a string
+ * Written by ng.h@husky.neu.edu & pazol.l@husky.neu.edu
+ */
+class StringEqualsPredicate : public Predicate {
+public:
+
+    /** The index of the column */
+    size_t _column;
+
+    /** The string that matches. Owned by the predicate */
+    String* _value;
+
+    /**
+     * Default constructor
+     * @param column The index of the column
+     * @param value The string that matches. Owned by the predicate
+     */
+    StringEqualsPredicate(size_t column, String* value) : _column(column), _value(value) {}
+
+    ~StringEqualsPredicate() { delete _value; }
+
+    bool matches(Row& r) override {
+        String* value = r.get_string(_column);
+        return value && value->equals(_value);
+    }
+
+    bool serialize(Serializer& serializer) override {
+        serializer.write((uint8_t)STRING_EQUALS_PREDICATE);
+        serializer.write((uint64_t)_column);
+        serializer.write(_value);
+        return true;
+    }
+};
+
+/**
+ * A reader that can be run on every node over the chunks stored there by DataFrame::distributed_map. Its type is
+ * registered under a name on every node, so that a copy of it can be created there, and the results of the copies are
+ * joined back into the original
+ * Written by ng.h@husky.neu.edu & pazol.l@husky.neu.edu
+ */
+class DistributedReader : public Reader {
+public:
+
+    /** Creates a reader of a registered type from the arguments that the original wrote out */
+    typedef std::function<DistributedReader*(Deserializer&)> Factory;
+
+    /** Writes out what a copy of this reader is created from on another node. Nothing by default */
+    virtual void serializeArgs(Serializer& serializer) {}
+
+    /** Writes out what this reader has computed */
+    virtual void serializeResult(Serializer& serializer) = 0;
+
+    /**
+     * Combines what a copy of this reader computed on another node into this reader
+     * @param result The result that the copy wrote out
+     */
+    virtual void join(Deserializer& result) = 0;
+
+    /**
+     * Registers a type of reader so that copies of it can be created on this node
+     * @param type The name to register the type under. The same on every node
+     * @param factory Creates a reader of the type
+     */
+    static void registerType(const char* type, Factory factory) {
+        std::lock_guard<std::mutex> lock(_registryMutex());
+        _registry()[type] = factory;
+    }
+
+    /**
+     * Creates a reader of a registered type
+     * @param type The name the type is registered under
+     * @param args The arguments that the original reader wrote out
+     * @return The reader, or nullptr if the type is not registered on this node. The caller owns it
+     */
+    static DistributedReader* create(const char* type, Deserializer& args) {
+        Factory factory;
+        {
+            std::lock_guard<std::mutex> lock(_registryMutex());
+            auto registered = _registry().find(type);
+            if (registered == _registry().end()) { return nullptr; }
+            factory = registered->second;
+        }
+
+        return factory(args);
+    }
+
+    /** The registered types of readers by name */
+    static std::map<std::string, Factory>& _registry() {
+        static std::map<std::string, Factory> registry;
+        return registry;
+    }
+
+    /** Mutex for the registry */
+    static std::mutex& _registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+};
+
+/**
+ * How long every node took to run its part of a distributed map, which shows which nodes are stragglers
+ * Written by ng.h@husky.neu.edu & pazol.l@husky.neu.edu
+ */
+class MapTimings {
+public:
+
+    /** The time every node took to read its chunks in microseconds, by node */
+    std::vector<uint64_t> micros;
+
+    /** Provides the node that took the longest */
+    size_t slowest() const {
+        size_t slowest = 0;
+        for (size_t node = 1; node < micros.size(); node++) {
+            if (micros[node] > micros[slowest]) { slowest = node; }
+        }
+
+        return slowest;
+    }
+};
+
+inline Predicate* Predicate::deserialize(Deserializer& deserializer) {
+    PredicateType type = (PredicateType)deserializer.read_uint8();
+    size_t column = deserializer.read_uint64();
+
+    switch (type) {
+        case RANGE_PREDICATE: {
+            double low = deserializer.read_double();
+            return new RangePredicate(column, low, deserializer.read_double());
+        }
+        case STRING_EQUALS_PREDICATE: return new StringEqualsPredicate(column, deserializer.read_string());
+        default: return nullptr;
+    }
+}
+
 
 
 /****************************************************************************
@@ -94,6 +352,9 @@ public:
     /** The collection of column objects */
     ElementColumn _columns;
 
+    /** Replied to a filter request by a node that does not have the chunk or does not know the type of the predicate */
+    static const uint64_t FILTER_MISSED = UINT64_MAX;
+
     /** Create a data frame with the same columns as the given df but with no rows or rownmaes */
     DataFrame(DataFrame& df) : DataFrame(df._schema) {}
 
@@ -197,6 +458,24 @@ public:
         }
     }
 
+    /**
+     * Copies rows of another dataframe with the same schema onto the end of this one. Strings are copied
+     * @param other The dataframe to copy rows from
+     * @param from The index of the first row to copy
+     * @param to The index after the last row to copy
+     */
+    void add_rows(DataFrame* other, size_t from, size_t to) {
+        Row row(_schema);
+        for (size_t idx = from; idx < to; idx++) {
+            other->_fillRow(row, idx);
+            for (size_t i = 0; i < _schema.width(); i++) {
+                if (_schema.col_type(i) == STRING && row.get_string(i)) { row.set(i, row.get_string(i)->clone()); }
+            }
+
+            add_row(row);
+        }
+    }
+
     /** The number of rows in the dataframe. */
     size_t nrows() { return getColumn(0)->size(); }
 
@@ -276,9 +555,10 @@ public:
      * @param kv The key value store to put the dataframe in
      * @param count The number of items in values
      * @param values The values to put into the dataframe
+     * @param hint Optional. Where to home the chunks instead of where the store's placement policy puts them
      */
-    static void fromArray(Key* key, KVStore* kv, size_t count, int* values) {
-        _fromArray(key, kv, count, values, INT);
+    static void fromArray(Key* key, KVStore* kv, size_t count, int* values, const PlacementHint& hint = PlacementHint()) {
+        _fromArray(key, kv, count, values, INT, hint);
     }
 
     /**
@@ -288,9 +568,10 @@ public:
      * @param kv The key value store to put the dataframe in
      * @param count The number of items in values
      * @param values The values to put into the dataframe
+     * @param hint Optional. Where to home the chunks instead of where the store's placement policy puts them
      */
-    static void fromArray(Key* key, KVStore* kv, size_t count, bool* values) {
-        _fromArray(key, kv, count, values, BOOL);
+    static void fromArray(Key* key, KVStore* kv, size_t count, bool* values, const PlacementHint& hint = PlacementHint()) {
+        _fromArray(key, kv, count, values, BOOL, hint);
     }
 
     /**
@@ -300,9 +581,10 @@ public:
      * @param kv The key value store to put the dataframe in
      * @param count The number of items in values
      * @param values The values to put into the dataframe
+     * @param hint Optional. Where to home the chunks instead of where the store's placement policy puts them
      */
-    static void fromArray(Key* key, KVStore* kv, size_t count, double* values) {
-        _fromArray(key, kv, count, values, DOUBLE);
+    static void fromArray(Key* key, KVStore* kv, size_t count, double* values, const PlacementHint& hint = PlacementHint()) {
+        _fromArray(key, kv, count, values, DOUBLE, hint);
     }
 
     /**
@@ -312,15 +594,16 @@ public:
      * @param kv The key value store to put the dataframe in
      * @param count The number of items in values
      * @param values The values to put into the dataframe
+     * @param hint Optional. Where to home the chunks instead of where the store's placement policy puts them
      */
-    static void fromArray(Key* key, KVStore* kv, size_t count, String** values) {
+    static void fromArray(Key* key, KVStore* kv, size_t count, String** values, const PlacementHint& hint = PlacementHint()) {
         // Copy the values since the dataframe will own the strings and delete them once its in the store
         String** copy = new String*[count];
         for (size_t i = 0; i < count; i++) {
             copy[i] = values[i]->clone();
         }
 
-        _fromArray(key, kv, count, copy, STRING);
+        _fromArray(key, kv, count, copy, STRING, hint);
         delete[] copy;
     }
 
@@ -332,19 +615,20 @@ public:
      * @param count The number of items in values
      * @param values The values to put into the dataframe
      * @param c The type to use for the schema
+     * @param hint Where to home the chunks
      */
     template <typename T>
-    static void _fromArray(Key* key, KVStore* kv, size_t count, T* values, ColumnType c) {
+    static void _fromArray(Key* key, KVStore* kv, size_t count, T* values, ColumnType c, const PlacementHint& hint) {
         const char charSchema[2] = {(char)c, '\0'};
         Schema schema(charSchema);
-        DataFrame dataFrame(schema);
         Row row(schema);
 
-        for (int i = 0; i < count; i++) {
-            row.set(0, values[i]);
-            dataFrame.add_row(row);
-        }
-        kv->put(&dataFrame, *key);
+        size_t i = 0;
+        _fromLambda(key, kv, charSchema, [&](DataFrame* df) {
+            row.set(0, values[i++]);
+            df->add_row(row);
+            return true;
+        }, [&] { return i < count; }, count, hint);
     }
 
     /**
@@ -353,16 +637,18 @@ public:
      * @param kv The key value store to put the dataframe in
      * @param charSchema The schema of the dataframe
      * @param writer The visitor to use to create the dataframe
+     * @param hint Optional. Where to home the chunks instead of where the store's placement policy puts them
      * @return The number of rows in the new dataframe
      */
-    static size_t fromVisitor(Key* key, KVStore* kv, const char* charSchema, Writer* writer) {
+    static size_t fromVisitor(Key* key, KVStore* kv, const char* charSchema, Writer* writer,
+                              const PlacementHint& hint = PlacementHint()) {
         Schema schema(charSchema);
         Row row(schema);
         return _fromLambda(key, kv, charSchema, [&](DataFrame* df) {
             writer->visit(row);
             df->add_row(row);
             return true;
-        }, [&]{ return !writer->done(); });
+        }, [&]{ return !writer->done(); }, 0, hint);
     }
 
     /**
@@ -399,49 +685,98 @@ public:
      * @param schema The schema of the dataframe
      * @param populate A lambda that adds a single row to the given dataframe. This should return true if a new row was added
      * @param hasMore A lambda that returns true if there is more data to read
+     * @param expectedRows Optional. The number of rows the dataframe is expected to have. 0 if it is not known
+     * @param hint Optional. Where to home the chunks
      * @return The number of rows in the dataframe
      */
-    static size_t _fromLambda(Key* key, KVStore* kv, const char* schema, std::function<bool(DataFrame*)> populate, std::function<bool()> hasMore) {
+    static size_t _fromLambda(Key* key, KVStore* kv, const char* schema, std::function<bool(DataFrame*)> populate, std::function<bool()> hasMore,
+                              size_t expectedRows = 0, const PlacementHint& hint = PlacementHint()) {
         Schema s(schema);
         DataFrame* dataFrame = new DataFrame(s);
 
         size_t nodes = kv->_byteStore.nodes();
+        size_t copies = kv->_copies(nodes);
+        uint64_t generation = kv->_newGeneration();
         size_t chunks = 0;
         size_t rows = 0;
 
-        while (hasMore()) {
-            if (populate(dataFrame)) {
-                rows++;
+        // Without an expected number of rows, rows are collected up to the largest chunk size before anything is
+        // uploaded, so that a dataframe that fits in it can still be split evenly over the cluster once it is complete
+        size_t chunkRows = expectedRows ? Column::chunkRowsFor(expectedRows, schema, nodes) : Column::maxChunkRows(schema);
+        std::unique_ptr<PlacementPolicy> policy(kv->_policyFor(hint, chunkRows));
+
+        // The nodes of every copy of every chunk. A deque so that the entries of chunks that are being uploaded do
+        // not move when more chunks are added
+        std::deque<std::vector<size_t>> homes;
+
+        // The zone maps of every column of every chunk, filled in by the uploads
+        std::deque<std::vector<ZoneMap>> zoneMaps;
+
+        {
+            // Full chunks are serialized and uploaded in the background while the next chunk is filled. Submitting
+            // blocks once the uploads fall behind, which bounds the number of chunks in memory
+            Workers uploads(KVStore::INGEST_WINDOW);
+
+            // Uploads the rows collected so far as chunks. The chunks share the dataframe, which is deleted once
+            // the last of them is uploaded
+            auto putChunks = [&] {
+                std::shared_ptr<DataFrame> full(dataFrame);
+                size_t fullChunks = full->nrows() / chunkRows + (full->nrows() % chunkRows ? 1 : 0);
 
-                if (dataFrame->nrows() == Column::CHUNK_SIZE) {
-                    kv->putDataframeChunk(*key, dataFrame, chunks, nodes, 0);
-                    chunks++;
+                for (size_t i = 0; i < fullChunks; i++) {
+                    homes.emplace_back(copies);
+                    kv->_homesFor(*key, chunks, nodes, copies, homes.back().data(), policy.get());
 
-                    delete dataFrame;
-                    dataFrame = new DataFrame(s);
+                    zoneMaps.emplace_back(full->ncols());
+
+                    size_t* chunkHomes = homes.back().data();
+                    ZoneMap* chunkZoneMaps = zoneMaps.back().data();
+                    size_t chunk = chunks++;
+                    uploads.submit([=] {
+                        for (size_t col = 0; col < full->ncols(); col++) {
+                            chunkZoneMaps[col] = full->getColumn(col)->zoneMapOf(i, chunkRows);
+                        }
+
+                        kv->putDataframeChunk(*key, generation, full.get(), chunk, chunkHomes, copies, chunkRows, i);
+                    });
                 }
-            }
-        }
+            };
 
-        if (dataFrame->nrows()) {
-            kv->putDataframeChunk(*key, dataFrame, chunks, nodes, 0);
-            chunks++;
-        }
+            while (hasMore()) {
+                if (populate(dataFrame)) {
+                    rows++;
 
-        delete dataFrame;
+                    if (dataFrame->nrows() == chunkRows) {
+                        putChunks();
+                        dataFrame = new DataFrame(s);
+                    }
+                }
+            }
 
-        // Generate the description
-        size_t columns = s.width();
-        ColumnDescription** descriptions = new ColumnDescription*[columns];
+            // Nothing was uploaded yet, so the dataframe is put whole. That picks the chunk size from the actual
+            // number of rows, and stores a small dataframe inside of its description
+            if (!chunks) {
+                kv->put(dataFrame, *key, hint);
+                delete dataFrame;
+                return rows;
+            }
 
-        for (size_t i = 0; i < columns; i++) {
-            Key** chunkKeys = new Key*[chunks];
+            if (dataFrame->nrows()) {
+                putChunks();
+            } else {
+                delete dataFrame;
+            }
+        }
 
-            for (size_t chunk = 0; chunk < chunks; chunk++) { chunkKeys[chunk] = kv->_keyFor(*key, i, chunk, nodes); }
-            descriptions[i] = new ColumnDescription(chunkKeys, chunks, rows, (ColumnType)s.col_type(i));
+        // Generate the description
+        DataframeDescription* desc = new DataframeDescription(new String(schema), new String(key->getName()), generation, rows,
+                                                              chunkRows, copies);
+        desc->pinned = policy != nullptr;
+        desc->keyNode = (uint8_t)key->getNode();
+        for (size_t chunk = 0; chunk < homes.size(); chunk++) {
+            desc->addChunk(homes[chunk].data(), zoneMaps[chunk].data());
         }
 
-        DataframeDescription* desc = new DataframeDescription(new String(schema), columns, descriptions);
         kv->putDataframeDesc(*key, desc);
         delete desc;
 
@@ -502,23 +837,351 @@ public:
         }
     }
 
+    /** Visits the rows that match a predicate in order, skipping the chunks that can not contain a match */
+    void map(Reader& r, Predicate& p) { _filteredMap(r, p, false); }
+
+    /** Visits the rows that match a predicate in order if they are stored on this machine */
+    void local_map(Reader& r, Predicate& p) { _filteredMap(r, p, true); }
+
+    /**
+     * Visits the rows that match a predicate in order. The chunks that are ruled out are never read, or read ahead
+     * @param r The reader to visit the rows with
+     * @param p The predicate the rows must match
+     * @param localOnly Whether only the chunks whose home copy is stored on this machine are visited
+     */
+    void _filteredMap(Reader& r, Predicate& p, bool localOnly) {
+        Row row(_schema);
+        ChunkedColumn* chunkedCol = ncols() ? dynamic_cast<ChunkedColumn*>(getColumn(0)) : nullptr;
+        if (chunkedCol == nullptr) {
+            for (size_t idx = 0; !localOnly && idx < nrows(); idx++) {
+                _fillRow(row, idx);
+                if (p.matches(row)) { r.visit(row); }
+            }
+
+            return;
+        }
+
+        DataframeDescription& description = *chunkedCol->_description;
+        std::vector<bool> skipped(description.chunks);
+        for (size_t i = 0; i < description.chunks; i++) {
+            skipped[i] = (localOnly && !chunkedCol->isChunkLocal(i)) || !p.mayMatch(description, i);
+        }
+
+        _skipChunks(skipped);
+
+        std::vector<size_t> surviving;
+        for (size_t i = 0; i < description.chunks; i++) {
+            if (!skipped[i]) { surviving.push_back(i); }
+        }
+
+        // The predicate is evaluated on the home node of every chunk unless the rows are all in the description
+        Serializer predicate;
+        bool pushdown = !description.isInline() && p.serialize(predicate);
+
+        // The filters of the chunks after the one being visited are sent on the read ahead workers, so that their
+        // round trips overlap. The replies are still visited in chunk order
+        KBStore& kbstore = chunkedCol->_kbstore;
+        size_t ahead = std::max((size_t)1, (size_t)kbstore._readAhead);
+        std::vector<ByteArray*> replies(surviving.size(), nullptr);
+        std::mutex repliesMutex;
+        std::condition_variable replied;
+        size_t sent = 0;
+
+        size_t chunkRows = description.chunkRows;
+        for (size_t next = 0; next < surviving.size(); next++) {
+            for (; pushdown && sent < surviving.size() && sent <= next + ahead; sent++) {
+                size_t position = sent;
+                kbstore.readAheadWorkers.submit([&, position] {
+                    size_t chunk = surviving[position];
+                    Serializer request;
+                    _writeFilter(request, description, chunk, predicate);
+                    ByteArray* reply = kbstore.filter(description.nodeOf(chunk, 0), request);
+
+                    std::lock_guard<std::mutex> lock(repliesMutex);
+                    replies[position] = reply;
+                    replied.notify_all();
+                });
+            }
+
+            if (pushdown) {
+                std::unique_lock<std::mutex> lock(repliesMutex);
+                replied.wait(lock, [&] { return replies[next] != nullptr; });
+                lock.unlock();
+
+                if (_visitFiltered(r, replies[next], row)) { continue; }
+            }
+
+            size_t i = surviving[next];
+            for (size_t idx = i * chunkRows; idx < (i + 1) * chunkRows && idx < nrows(); idx++) {
+                _fillRow(row, idx);
+                if (p.matches(row)) { r.visit(row); }
+            }
+        }
+
+        _skipChunks(std::vector<bool>());
+    }
+
+    /**
+     * Writes a request to evaluate a predicate against a chunk on the chunk's home node
+     * @param request The serializer to write the request with
+     * @param description The description of the dataframe
+     * @param chunk The index of the chunk
+     * @param predicate The serialized predicate
+     */
+    static void _writeFilter(Serializer& request, DataframeDescription& description, size_t chunk, Serializer& predicate) {
+        request.write(description.name);
+        request.write(description.generationOf(chunk));
+        request.write((uint64_t)chunk);
+        request.write(description.chunkRows);
+        request.write(description.schema);
+        request._write(predicate.getBuffer(), predicate.getSize());
+    }
+
+    /**
+     * Visits the rows of a chunk that matched a predicate on the chunk's home node, so that only the matching rows
+     * were sent to this node
+     * @param r The reader to visit the rows with
+     * @param reply The reply to the filter request. Deleted once it is read
+     * @param row The row to visit the rows with
+     * @return false if nothing was visited, since the home node does not have the chunk
+     */
+    bool _visitFiltered(Reader& r, ByteArray* reply, Row& row) {
+        Deserializer deserializer(reply->length, reply->contents);
+
+        uint64_t matches = deserializer.read_uint64();
+        for (size_t i = 0; matches != FILTER_MISSED && i < matches; i++) {
+            row.set_idx(deserializer.read_uint64());
+            for (size_t col = 0; col < _schema.width(); col++) {
+                if (_schema.col_type(col) == STRING) {
+                    row.set(col, deserializer.read_string());
+                } else {
+                    row._entries[col] = deserializer.read_element();
+                }
+            }
+
+            r.visit(row);
+
+            for (size_t col = 0; col < _schema.width(); col++) {
+                if (_schema.col_type(col) == STRING) { delete row.get_string(col); }
+            }
+        }
+
+        delete reply;
+        return matches != FILTER_MISSED;
+    }
+
+    /**
+     * Evaluates a filter request against a chunk of a dataframe that is stored on this node. The reply is the number
+     * of matching rows followed by the index and the values of every one of them, or FILTER_MISSED if the chunk is
+     * not stored here or the predicate is of a type this node does not know, so that the chunk is read and filtered
+     * by the caller instead
+     * @param kbstore The store of this node
+     * @param request The name and generation of the dataframe, the index of the chunk, the number of rows in every
+     *                chunk but the last, the schema and the predicate
+     * @param reply The serializer to write the reply with
+     */
+    static void _filterChunk(KBStore& kbstore, Deserializer& request, Serializer& reply) {
+        String* name = request.read_string();
+        uint64_t generation = request.read_uint64();
+        uint64_t chunk = request.read_uint64();
+        uint64_t chunkRows = request.read_uint64();
+        String* types = request.read_string();
+        Predicate* predicate = Predicate::deserialize(request);
+
+        Schema schema(types->c_str());
+        std::vector<Element*> elements(schema.width(), nullptr);
+        uint64_t rows = 0;
+        bool found = predicate != nullptr;
+        for (size_t col = 0; col < schema.width() && found; col++) {
+            Key* key = DataframeDescription::chunkKey(name->c_str(), generation, col, chunk, kbstore.this_node());
+            ByteArray* bytes = kbstore.get(*key);
+            delete key;
+
+            found = bytes != nullptr;
+            if (found) {
+                Deserializer deserializer(bytes->length, bytes->contents);
+                elements[col] = deserializeChunkOfType(schema.col_type(col), deserializer, rows);
+                delete bytes;
+            }
+        }
+
+        if (!found) {
+            reply.write(FILTER_MISSED);
+        } else {
+            Row row(schema);
+            std::vector<size_t> matches;
+            for (size_t i = 0; i < rows; i++) {
+                for (size_t col = 0; col < schema.width(); col++) {
+                    row._entries[col] = elements[col][i];
+                }
+
+                if (predicate->matches(row)) { matches.push_back(i); }
+            }
+
+            reply.write((uint64_t)matches.size());
+            for (size_t i : matches) {
+                reply.write((uint64_t)(chunk * chunkRows + i));
+                for (size_t col = 0; col < schema.width(); col++) {
+                    if (schema.col_type(col) == STRING) {
+                        reply.write(elements[col][i].s);
+                    } else {
+                        reply.write(elements[col][i]);
+                    }
+                }
+            }
+        }
+
+        for (size_t col = 0; col < schema.width(); col++) {
+            for (size_t i = 0; elements[col] && schema.col_type(col) == STRING && i < rows; i++) {
+                delete elements[col][i].s;
+            }
+
+            delete[] elements[col];
+        }
+
+        delete name;
+        delete types;
+        delete predicate;
+    }
+
+    /**
+     * Tells every chunked column which chunks the scan in progress will not read, so they are not read ahead
+     * @param skipped Whether each chunk is skipped. Empty once the scan is over
+     */
+    void _skipChunks(const std::vector<bool>& skipped) {
+        for (size_t i = 0; i < ncols(); i++) {
+            ChunkedColumn* chunkedCol = dynamic_cast<ChunkedColumn*>(getColumn(i));
+            if (chunkedCol) { chunkedCol->_skipped = skipped; }
+        }
+    }
+
     /** Visits rows in order if they are stored on this machine */
     void local_map(Reader& r) {
+        ChunkedColumn* chunkedCol = dynamic_cast<ChunkedColumn*>(getColumn(0));
+        if (chunkedCol != nullptr) { _nodeMap(r, chunkedCol->_kbstore.this_node()); }
+    }
+
+    /**
+     * Visits the rows of the chunks whose home copy is on a node in order. Only the node with the first copy of a
+     * chunk visits it, so replicated chunks are visited once
+     * @param r The reader to visit the rows with
+     * @param node The node
+     */
+    void _nodeMap(Reader& r, size_t node) {
         Column* column = getColumn(0);
         ChunkedColumn* chunkedCol = dynamic_cast<ChunkedColumn*>(column);
 
+        // The chunks of other nodes are not read ahead
+        std::vector<bool> skipped(chunkedCol->_chunkCount);
+        for (size_t i = 0; i < chunkedCol->_chunkCount; i++) {
+            skipped[i] = chunkedCol->_description->nodeOf(i, 0) != node;
+        }
+
+        _skipChunks(skipped);
+
         Row row(get_schema());
-        if (chunkedCol != nullptr) {
-            for (size_t i = 0; i < chunkedCol->_chunkCount; i++) {
-                Key* currKey = chunkedCol->_keys[i];
-                if (chunkedCol->isKeyLocal(currKey)) {
-                    for (size_t idx = 0; idx < Column::CHUNK_SIZE && i * Column::CHUNK_SIZE + idx < column->size(); idx++) {
-                        _fillRow(row, i * Column::CHUNK_SIZE + idx);
-                        r.visit(row);
-                    }
-                }
+        size_t chunkRows = chunkedCol->_chunkRows;
+        for (size_t i = 0; i < chunkedCol->_chunkCount; i++) {
+            for (size_t idx = 0; !skipped[i] && idx < chunkRows && i * chunkRows + idx < column->size(); idx++) {
+                _fillRow(row, i * chunkRows + idx);
+                r.visit(row);
             }
         }
+
+        _skipChunks(std::vector<bool>());
+    }
+
+    /**
+     * Runs a reader on every node over the chunks whose home copy is stored there, at the same time, and joins the
+     * results of the other nodes into the given reader. Chunks of nodes that do not have the reader's type registered
+     * are read by this node instead
+     * @param type The name the reader's type is registered under
+     * @param r The reader. Reads this node's chunks and is joined with the results of the other nodes
+     * @return How long every node took to read its chunks
+     */
+    MapTimings distributed_map(const char* type, DistributedReader& r) {
+        MapTimings timings;
+        ChunkedColumn* chunkedCol = ncols() ? dynamic_cast<ChunkedColumn*>(getColumn(0)) : nullptr;
+        if (chunkedCol == nullptr) {
+            timings.micros.push_back(_timeMicros([&] { map(r); }));
+            return timings;
+        }
+
+        KBStore& kbstore = chunkedCol->_kbstore;
+        size_t nodes = kbstore.nodes();
+        size_t self = kbstore.this_node();
+
+        String typeString(type);
+        Serializer request;
+        request.write(&typeString);
+        chunkedCol->_description->serialize(request);
+        r.serializeArgs(request);
+
+        std::vector<ByteArray*> replies(nodes, nullptr);
+        std::vector<std::thread> maps;
+        for (size_t node = 0; node < nodes; node++) {
+            if (node != self) { maps.emplace_back([&, node] { replies[node] = kbstore.mapOn(node, request); }); }
+        }
+
+        timings.micros.assign(nodes, 0);
+        timings.micros[self] = _timeMicros([&] { _nodeMap(r, self); });
+
+        for (std::thread& map : maps) {
+            map.join();
+        }
+
+        for (size_t node = 0; node < nodes; node++) {
+            if (node == self) { continue; }
+
+            Deserializer deserializer(replies[node]->length, replies[node]->contents);
+            if (deserializer.read_uint8()) {
+                timings.micros[node] = deserializer.read_uint64();
+                r.join(deserializer);
+            } else {
+                timings.micros[node] = _timeMicros([&] { _nodeMap(r, node); });
+            }
+
+            delete replies[node];
+        }
+
+        return timings;
+    }
+
+    /**
+     * Runs this node's part of a distributed map. Registered with the KBStore by the KVStore. The reply is whether
+     * the reader's type is registered here, and if it is, how long the map took followed by the reader's result
+     * @param kv The store of this node
+     * @param request The name of the reader's type, the description of the dataframe and the reader's arguments
+     * @param reply The serializer to write the reply with
+     */
+    static void _mapChunks(KVStore& kv, Deserializer& request, Serializer& reply) {
+        String* type = request.read_string();
+        std::shared_ptr<DataframeDescription> description = std::make_shared<DataframeDescription>();
+        description->deserialize(request);
+
+        DistributedReader* reader = DistributedReader::create(type->c_str(), request);
+        reply.write((uint8_t)(reader != nullptr));
+        if (reader) {
+            DataFrame* dataframe = kv._dataframeFrom(description);
+            reply.write(_timeMicros([&] { dataframe->_nodeMap(*reader, kv.this_node()); }));
+            reader->serializeResult(reply);
+
+            delete dataframe;
+            delete reader;
+        }
+
+        delete type;
+    }
+
+    /**
+     * Times a function
+     * @param fn The function to run
+     * @return How long the function took in microseconds
+     */
+    static uint64_t _timeMicros(std::function<void()> fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
     }
 
 };
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+// Language: C++
+
+#include <atomic>
+#include <memory>
+
+#include "../utils/instructor-provided/object.h"
+
+/**
+ * A byte array with a length and contents
+ * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
+ */
+class ByteArray: public Object {
+    public:
+
+        /** The contents of the buffer */
+        const char* contents;
+
+        /** The length of the buffer */
+        size_t length;
+
+        /** True if this byte array owns its data */
+        bool _ownsData;
+
+        /** The version of the value that these bytes were read from. 0 if the version is not known */
+        uint64_t version = 0;
+
+        /** When the value expires, in milliseconds on the steady clock of its home node. 0 if it never expires */
+        std::atomic<uint64_t> expiresAt{0};
+
+        /** When the value was last read, in milliseconds on the steady clock of its home node */
+        std::atomic<uint64_t> lastAccess{0};
+
+        /** True if the contents were compressed with Codec and have to be decompressed before they are used */
+        bool compressed = false;
+
+        /** The buffer this array shares with others, if any. The buffer stays alive while any array shares it */
+        std::shared_ptr<const char> _buffer;
+
+        /** Default constructor */
+        ByteArray(const char *contents, size_t length, bool ownsData = true) : contents(contents), length(length), _ownsData(ownsData) {}
+
+        /**
+         * Creates a byte array that shares a buffer
+         * @param buffer The buffer to share
+         * @param contents Where the bytes start inside of the buffer
+         * @param length The length of the bytes
+         */
+        ByteArray(const std::shared_ptr<const char>& buffer, const char* contents, size_t length) : contents(contents),
+                                                                                                  length(length),
+                                                                                                  _ownsData(false),
+                                                                                                  _buffer(buffer) {}
+
+        virtual ~ByteArray() {
+            if (_ownsData) {
+                delete[] contents;
+            }
+        }
+
+        /**
+         * Creates a byte array that takes ownership of a heap buffer and can share it with other byte arrays
+         * @param contents The buffer, allocated with new[]
+         * @param length The length of the buffer
+         */
+        static ByteArray* shared(const char* contents, size_t length) {
+            return new ByteArray(std::shared_ptr<const char>(contents, std::default_delete<const char[]>()), contents, length);
+        }
+
+        /**
+         * Provides a new byte array that shares this array's buffer, so the bytes stay valid even if this
+         * array is deleted. Only valid for arrays that have a shared buffer
+         */
+        ByteArray* share() {
+            ByteArray* view = new ByteArray(_buffer, contents, length);
+            view->version = version;
+            return view;
+        }
+
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+// Language: C++
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * A node wide budget for the chunks that columns have deserialized. Chunks are evicted least recently used first once
+ * the budget is exceeded, and their owner reloads them if they are read again. Every owner can pin the one chunk it is
+ * reading, which is never evicted, so the budget can be exceeded by the pinned chunks alone.
+ * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
+ */
+class ChunkBudget {
+    public:
+
+        /** Something that holds chunks that are charged to the budget */
+        class Owner {
+            public:
+                virtual ~Owner() {}
+
+                /**
+                 * Frees a chunk. Called with the budget's mutex held, so it must not call back into the budget
+                 * @param chunk The index of the chunk
+                 */
+                virtual void evict(size_t chunk) = 0;
+        };
+
+        /** A chunk that is charged to the budget */
+        struct Entry {
+            /** The owner of the chunk */
+            Owner* owner;
+
+            /** The index of the chunk */
+            size_t chunk;
+
+            /** The number of bytes the chunk is charged */
+            size_t bytes;
+        };
+
+        /** The default number of bytes of chunks a node holds */
+        static const size_t DEFAULT_CAPACITY = 512 * 1024 * 1024;
+
+        /** The chunks ordered from most to least recently used */
+        std::list<Entry> _recency;
+
+        /** The position of every chunk in _recency */
+        std::map<std::pair<Owner*, size_t>, std::list<Entry>::iterator> _entries;
+
+        /** The chunk each owner has pinned */
+        std::unordered_map<Owner*, size_t> _pinned;
+
+        /** Mutex for everything in the budget */
+        std::mutex _mutex;
+
+        /** The maximum number of bytes of chunks */
+        size_t _capacity;
+
+        /** The number of bytes of chunks currently held */
+        size_t _size = 0;
+
+        /** The number of reads of a chunk that was already held */
+        size_t hits = 0;
+
+        /** The number of reads of a chunk that had to be loaded */
+        size_t misses = 0;
+
+        /** The number of chunks that were evicted to stay within the budget */
+        size_t evictions = 0;
+
+        /**
+         * Default constructor
+         * @param capacity The maximum number of bytes of chunks
+         */
+        ChunkBudget(size_t capacity = DEFAULT_CAPACITY) : _capacity(capacity) {}
+
+        /**
+         * Pins the chunk an owner is about to read, unpinning the one it read before
+         * @param owner The owner of the chunk
+         * @param chunk The index of the chunk
+         */
+        void pin(Owner* owner, size_t chunk) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pinned[owner] = chunk;
+        }
+
+        /**
+         * Marks a chunk as used
+         * @param owner The owner of the chunk
+         * @param chunk The index of the chunk
+         */
+        void touch(Owner* owner, size_t chunk) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            hits++;
+
+            auto entry = _entries.find(std::make_pair(owner, chunk));
+            if (entry != _entries.end()) { _recency.splice(_recency.begin(), _recency, entry->second); }
+        }
+
+        /**
+         * Charges a chunk that was just loaded to the budget, evicting other chunks if it is exceeded
+         * @param owner The owner of the chunk
+         * @param chunk The index of the chunk
+         * @param bytes The number of bytes the chunk is charged
+         * @param read Whether the chunk was loaded because it was read, rather than ahead of a read
+         */
+        void add(Owner* owner, size_t chunk, size_t bytes, bool read) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (read) { misses++; }
+
+            _recency.push_front(Entry{owner, chunk, bytes});
+            _entries[std::make_pair(owner, chunk)] = _recency.begin();
+            _size += bytes;
+
+            _shrink();
+        }
+
+        /**
+         * Stops charging the chunks of an owner without evicting them. Called when the owner is destroyed
+         * @param owner The owner
+         */
+        void remove(Owner* owner) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pinned.erase(owner);
+
+            for (auto entry = _recency.begin(); entry != _recency.end();) {
+                if (entry->owner == owner) {
+                    _entries.erase(std::make_pair(owner, entry->chunk));
+                    _size -= entry->bytes;
+                    entry = _recency.erase(entry);
+                } else {
+                    entry++;
+                }
+            }
+        }
+
+        /**
+         * Changes the maximum number of bytes of chunks. Evicts chunks if the budget is now exceeded
+         * @param capacity The new capacity in bytes
+         */
+        void setCapacity(size_t capacity) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _capacity = capacity;
+            _shrink();
+        }
+
+        /** Provides the number of bytes of chunks that are currently held */
+        size_t size() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _size;
+        }
+
+        /** Evicts the least recently used chunks that are not pinned until the budget is met. The mutex must be held */
+        void _shrink() {
+            auto entry = _recency.end();
+            while (_size > _capacity && entry != _recency.begin()) {
+                entry--;
+
+                auto pinned = _pinned.find(entry->owner);
+                if (pinned != _pinned.end() && pinned->second == entry->chunk) { continue; }
+
+                evictions++;
+                entry->owner->evict(entry->chunk);
+                _entries.erase(std::make_pair(entry->owner, entry->chunk));
+                _size -= entry->bytes;
+                entry = _recency.erase(entry);
+            }
+        }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+// Language: C++
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "../utils/fingerprint.h"
+#include "byte_array.h"
+
+/**
+ * The unique bodies of the values stored on a node, by fingerprint. Values with the same bytes share one buffer, and
+ * the buffer's shared count is the number of references to it, so a body is freed once the last value that uses it
+ * is gone. The table only remembers bodies weakly so that it never keeps one alive
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class ContentTable {
+    public:
+
+        /** The smallest body that is worth remembering */
+        static const size_t MIN_CONTENT_SIZE = 256;
+
+        /** A body that is stored on this node */
+        struct Content {
+            /** The buffer the body is in */
+            std::weak_ptr<const char> buffer;
+
+            /** Where the body starts inside of the buffer */
+            const char* contents;
+
+            /** The length of the body */
+            size_t length;
+        };
+
+        /** The bodies by their fingerprint */
+        std::unordered_map<Fingerprint, Content, Fingerprint::Hash> _contents;
+
+        /** Mutex for _contents */
+        std::mutex _mutex;
+
+        /** The number of values that were stored in a body that was already stored */
+        std::atomic<size_t> deduplicated;
+
+        /** The number of bytes that did not have to be stored again */
+        std::atomic<size_t> deduplicatedBytes;
+
+        /** Default constructor */
+        ContentTable() : deduplicated(0), deduplicatedBytes(0) {}
+
+        /**
+         * Provides a body that is already stored
+         * @param fingerprint The fingerprint of the body
+         * @param length The length of the body
+         * @return A byte array that shares the body, or nullptr if it is not stored
+         */
+        ByteArray* find(const Fingerprint& fingerprint, size_t length) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _find(fingerprint, length);
+        }
+
+        /**
+         * Makes a value share the body of a value with the same bytes if there is one, otherwise remembers its body
+         * @param bytes The value. Must have a shared buffer. Deleted if its body is already stored
+         * @return The value to store
+         */
+        ByteArray* intern(ByteArray* bytes) {
+            if (bytes->length < MIN_CONTENT_SIZE) { return bytes; }
+
+            Fingerprint fingerprint(bytes->contents, bytes->length);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            ByteArray* existing = _find(fingerprint, bytes->length);
+
+            // Bodies whose fingerprints collide are stored separately, and the body that is already remembered stays
+            if (existing && memcmp(existing->contents, bytes->contents, bytes->length)) {
+                delete existing;
+                return bytes;
+            }
+
+            if (existing) {
+                deduplicated++;
+                deduplicatedBytes += bytes->length;
+                delete bytes;
+                return existing;
+            }
+
+            _contents[fingerprint] = Content{bytes->_buffer, bytes->contents, bytes->length};
+            return bytes;
+        }
+
+        /** Forgets the bodies that are no longer used by any value */
+        void sweep() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto content = _contents.begin(); content != _contents.end();) {
+                if (content->second.buffer.expired()) {
+                    content = _contents.erase(content);
+                } else {
+                    content++;
+                }
+            }
+        }
+
+        /** Provides the number of bodies that are remembered */
+        size_t size() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _contents.size();
+        }
+
+        /**
+         * Provides a body that is already stored. The mutex must be held
+         * @param fingerprint The fingerprint of the body
+         * @param length The length of the body
+         * @return A byte array that shares the body, or nullptr if it is not stored
+         */
+        ByteArray* _find(const Fingerprint& fingerprint, size_t length) {
+            auto content = _contents.find(fingerprint);
+            if (content == _contents.end() || content->second.length != length) { return nullptr; }
+
+            std::shared_ptr<const char> buffer = content->second.buffer.lock();
+            if (!buffer) { return nullptr; }
+
+            return new ByteArray(buffer, content->second.contents, length);
+        }
+};
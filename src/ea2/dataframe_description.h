@@ -1,123 +1,302 @@
 #pragma once
 
+#include <vector>
+
 #include "../utils/serial.h"
 #include "../utils/column_type.h"
 #include "../utils/key.h"
+#include "../utils/zone_map.h"
+#include "../utils/instructor-provided/string.h"
 #include "../network/shared/network.h"
 
 /**
- * Describes the location of one column and its type in the distributed value store
+ * Contains the description of a dataframe: its schema, its size and where every copy of every chunk is stored.
+ * The keys of the chunks are not stored. They are derived from the dataframe's name and the generation of the segment
+ * the chunk is in, so only the node of every copy is kept, one byte each, and the description stays small however
+ * many chunks there are. Chunks are never overwritten, since every put of a dataframe and every append to it writes
+ * its chunks in a new generation. A zone map of every chunk of every numeric column is kept as well, so that scans can
+ * rule out chunks from the description alone. Strings have no bounds to rule a chunk out by, so their zone maps are
+ * not kept and the description does not grow with the string columns. A small dataframe is not split into chunks at all, and is stored inside of
+ * its description instead, so that it is put and read in a single operation
  * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
  */
-class ColumnDescription: public Object {
+class DataframeDescription: public Object, public Codable {
     public:
 
-        /** The location of the data for the column */
-        Key** keys = nullptr;
+        /** The schema for the dataframe in string format. Owns this string */
+        String* schema = nullptr;
 
-        /** The number of chunks in the column */
-        uint64_t chunks = 0;
+        /** The name of the key the dataframe is stored under. The keys of the chunks start with it. Owns this string */
+        String* name = nullptr;
 
-        /** The total number of elements in the column */
-        uint64_t totalLength = 0;
+        /** A run of chunks that were written together, by a put or by an append */
+        struct Segment {
+            /** Distinguishes the chunks of the segment from the chunks of any other write under the same name */
+            uint64_t generation;
 
-        /** The type of the column */
-        ColumnType type = (ColumnType)'\0';
+            /** The index of the first chunk in the segment. The segment ends where the next one starts */
+            uint64_t firstChunk;
+        };
 
-        /** Default constructor */
-        ColumnDescription(Key **keys, uint64_t chunks, uint64_t totalLength, ColumnType type) : keys(keys),
-                                                                                                chunks(chunks),
-                                                                                                totalLength(totalLength),
-                                                                                                type(type) {}
+        /** The segments of the dataframe, in order of their first chunk. There is always at least one */
+        std::vector<Segment> segments;
 
-        /** Constructor for deserialization */
-        ColumnDescription() {}
+        /** The number of rows in the dataframe */
+        uint64_t rows = 0;
 
-        ~ColumnDescription() {
-            for (size_t i = 0; i < chunks; i++) {
-                delete keys[i];
-            }
+        /** The number of rows in every chunk but the last. The same for every column */
+        uint64_t chunkRows = 0;
 
-            delete[] keys;
-        }
+        /** The number of chunks in every column */
+        uint64_t chunks = 0;
 
-        /** Writes this description out to a buffer */
-        void serialize(Serializer &serializer) {
-            serializer.write(chunks);
-            serializer.write(totalLength);
-            serializer.write((uint8_t)type);
-            for (size_t i = 0; i < chunks; i++) {
-                serializer.write(*keys[i]);
-            }
-        }
+        /** The number of copies of each chunk */
+        uint64_t replication = 1;
 
-        /** Reads a description from a buffer */
-        void deserialize(Deserializer &deserializer) {
-            chunks = deserializer.read_uint64();
-            totalLength = deserializer.read_uint64();
-            type = (ColumnType)deserializer.read_uint8();
+        /**
+         * The node of every copy of every chunk. The copies of chunk i are at [i * replication, (i + 1) * replication)
+         * with the home node's copy first. All of the columns of a chunk are stored on the same nodes
+         */
+        std::vector<uint8_t> nodes;
 
-            keys = new Key*[chunks];
-            for (size_t i = 0; i < chunks; i++) {
-                keys[i] = deserializer.read_key();
-            }
-        }
+        /**
+         * The zone map of every chunk of every column that has them. The zone maps of chunk i are at
+         * [i * zoneMapColumns(), (i + 1) * zoneMapColumns()), in the order of the columns
+         */
+        std::vector<ZoneMap> zoneMaps;
 
-};
+        /**
+         * The rows of a small dataframe, as a single chunk of every column serialized one after the other. Empty if
+         * the dataframe is stored in chunks
+         */
+        std::vector<char> inlined;
 
-/**
- * Contains the description of a dataframe, where to find all of the columns and what the schema is
- * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
- */
-class DataframeDescription: public Object, public Codable {
-    public:
+        /** True if the chunks were homed where a hint asked for, in which case they are not moved to nodes that join */
+        bool pinned = false;
 
-        /** The schema for the dataframe in string format. Owns this string */
-        String* schema;
+        /** The node of the key the dataframe is stored under, so that a reader can read a newer description */
+        uint8_t keyNode = 0;
 
-        /** The number of columns in the _columns array */
-        uint64_t numColumns;
+        /** The version the description was stored at when it was read. 0 if unknown. Not serialized */
+        uint64_t version = 0;
 
-        /** Description of all of the columns. Owns this array. */
-        ColumnDescription** columns;
+        /**
+         * Default constructor
+         * @param schema The schema of the dataframe. Owned by the description
+         * @param name The name of the key the dataframe is stored under. Owned by the description
+         * @param generation The generation of the chunks of the first segment
+         * @param rows The number of rows in the dataframe
+         * @param chunkRows The number of rows in every chunk but the last
+         * @param replication The number of copies of each chunk
+         */
+        DataframeDescription(String* schema, String* name, uint64_t generation, uint64_t rows, uint64_t chunkRows,
+                             uint64_t replication) :
+            schema(schema), name(name), segments{Segment{generation, 0}}, rows(rows), chunkRows(chunkRows),
+            replication(replication) {}
 
-        /** Default constructor */
-        DataframeDescription(String *schema, uint64_t numColumns, ColumnDescription **columns) : schema(schema),
-                                                                                                numColumns(numColumns),
-                                                                                                columns(columns) {}
         /** Constructor for deserialization */
         DataframeDescription() {}
 
         ~DataframeDescription() {
             delete schema;
+            delete name;
+        }
+
+        /** Copies the description */
+        Object* clone() override {
+            DataframeDescription* copy = new DataframeDescription(schema->clone(), name->clone(), 0, rows, chunkRows, replication);
+            copy->segments = segments;
+            copy->chunks = chunks;
+            copy->nodes = nodes;
+            copy->zoneMaps = zoneMaps;
+            copy->inlined = inlined;
+            copy->pinned = pinned;
+            copy->keyNode = keyNode;
+            copy->version = version;
+            return copy;
+        }
+
+        /** Provides the key the dataframe is stored under. The caller owns it */
+        Key* key() const { return new Key(name->c_str(), keyNode); }
+
+        /** Determines if the rows of the dataframe are stored inside of the description */
+        bool isInline() const { return !inlined.empty(); }
+
+        /** Provides the number of columns */
+        size_t columns() const { return schema->size(); }
+
+        /** Provides the type of a column */
+        ColumnType typeOf(size_t column) const { return (ColumnType)schema->c_str()[column]; }
+
+        /** Determines if the chunks of a column have zone maps. Only numeric columns do, since strings have no bounds */
+        bool hasZoneMaps(size_t column) const { return typeOf(column) != STRING; }
+
+        /** Provides the number of columns whose chunks have zone maps */
+        size_t zoneMapColumns() const { return _zoneMapIndex(columns()); }
 
-            for (uint64_t i = 0; i < numColumns; i++) {
-                delete columns[i];
+        /**
+         * Adds a chunk to the end of every column
+         * @param homes The node of every copy of the chunk, starting with the home node
+         * @param chunkZoneMaps Optional. The zone map of the chunk in every column. If it is not given, the chunk is
+         *                      never ruled out. Only the zone maps of columns that have them are kept
+         */
+        void addChunk(const size_t* homes, const ZoneMap* chunkZoneMaps = nullptr) {
+            for (size_t copy = 0; copy < replication; copy++) {
+                nodes.push_back((uint8_t)homes[copy]);
             }
 
-            delete[] columns;
+            for (size_t column = 0; column < columns(); column++) {
+                if (hasZoneMaps(column)) { zoneMaps.push_back(chunkZoneMaps ? chunkZoneMaps[column] : ZoneMap()); }
+            }
+
+            chunks++;
+        }
+
+        /** Removes the last chunk from every column, and its segment if that leaves the segment empty */
+        void removeLastChunk() {
+            nodes.resize(nodes.size() - replication);
+            zoneMaps.resize(zoneMaps.size() - zoneMapColumns());
+            chunks--;
+
+            if (segments.size() > 1 && segments.back().firstChunk == chunks) { segments.pop_back(); }
+        }
+
+        /**
+         * Starts a new segment. Chunks that are added from now on are in it
+         * @param generation The generation of the chunks of the segment
+         */
+        void addSegment(uint64_t generation) {
+            if (segments.back().firstChunk == chunks) {
+                segments.back().generation = generation;
+            } else {
+                segments.push_back(Segment{generation, chunks});
+            }
+        }
+
+        /**
+         * Provides the generation of a chunk
+         * @param chunk The index of the chunk
+         */
+        uint64_t generationOf(size_t chunk) const {
+            size_t segment = segments.size() - 1;
+            while (segments[segment].firstChunk > chunk) { segment--; }
+            return segments[segment].generation;
+        }
+
+        /**
+         * Provides the node a copy of a chunk is stored on
+         * @param chunk The index of the chunk
+         * @param copy The index of the copy. 0 is the home node
+         */
+        size_t nodeOf(size_t chunk, size_t copy) const { return nodes[chunk * replication + copy]; }
+
+        /**
+         * Provides the zone map of a chunk of a column
+         * @param column The index of the column
+         * @param chunk The index of the chunk
+         * @return The zone map, or one that rules nothing out if the column does not have them
+         */
+        ZoneMap zoneMapOf(size_t column, size_t chunk) const {
+            if (!hasZoneMaps(column)) { return ZoneMap(); }
+            return zoneMaps[chunk * zoneMapColumns() + _zoneMapIndex(column)];
+        }
+
+        /**
+         * Provides the key of a copy of a chunk of a column
+         * @param column The index of the column
+         * @param chunk The index of the chunk
+         * @param copy The index of the copy
+         * @return The key. The caller owns it
+         */
+        Key* keyFor(size_t column, size_t chunk, size_t copy) const {
+            return chunkKey(name->c_str(), generationOf(chunk), column, chunk, nodeOf(chunk, copy));
+        }
+
+        /**
+         * Provides the key of a chunk of a column of a dataframe
+         * @param name The name of the key the dataframe is stored under
+         * @param generation The generation of the dataframe's chunks
+         * @param column The index of the column
+         * @param chunk The index of the chunk
+         * @param node The node the chunk is stored on
+         * @return The key. The caller owns it
+         */
+        static Key* chunkKey(const char* name, uint64_t generation, size_t column, size_t chunk, size_t node) {
+            const char separator[] = {Key::SEPARATOR, '\0'};
+            return new Key(StrBuff(name).c(separator).c(generation).c(separator).c(column).c(separator).c(chunk).get(), node);
         }
 
         /** Writes the description out to a buffer */
         void serialize(Serializer &serializer) {
             serializer.write(schema);
-            serializer.write(numColumns);
+            serializer.write(name);
+            serializer.write((uint64_t)segments.size());
+            for (Segment& segment : segments) {
+                serializer.write(segment.generation);
+                serializer.write(segment.firstChunk);
+            }
 
-            for (uint64_t i = 0; i < numColumns; i++) {
-                columns[i]->serialize(serializer);
+            serializer.write(rows);
+            serializer.write(chunkRows);
+            serializer.write(chunks);
+            serializer.write(replication);
+            serializer._write(nodes.data(), nodes.size());
+            for (ZoneMap& zoneMap : zoneMaps) {
+                zoneMap.serialize(serializer);
             }
+
+            serializer.write((uint64_t)inlined.size());
+            serializer._write(inlined.data(), inlined.size());
+            serializer.write((uint8_t)pinned);
+            serializer.write(keyNode);
         }
 
         /** Reads the description from a buffer */
         void deserialize(Deserializer &deserializer) {
             schema = deserializer.read_string();
-            numColumns = deserializer.read_uint64();
+            name = deserializer.read_string();
+            segments.resize(deserializer.read_uint64());
+            for (Segment& segment : segments) {
+                segment.generation = deserializer.read_uint64();
+                segment.firstChunk = deserializer.read_uint64();
+            }
+
+            rows = deserializer.read_uint64();
+            chunkRows = deserializer.read_uint64();
+            chunks = deserializer.read_uint64();
+            replication = deserializer.read_uint64();
+
+            char* read = deserializer.read(chunks * replication);
+            nodes.assign((uint8_t*)read, (uint8_t*)read + chunks * replication);
+            delete[] read;
 
-            columns = new ColumnDescription*[numColumns];
-            for (uint64_t i = 0; i < numColumns; i++) {
-                columns[i] = new ColumnDescription();
-                columns[i]->deserialize(deserializer);
+            zoneMaps.resize(chunks * zoneMapColumns());
+            for (ZoneMap& zoneMap : zoneMaps) {
+                zoneMap.deserialize(deserializer);
             }
+
+            size_t inlinedLength = deserializer.read_uint64();
+            char* inlinedRows = deserializer.read(inlinedLength);
+            inlined.assign(inlinedRows, inlinedRows + inlinedLength);
+            delete[] inlinedRows;
+
+            pinned = deserializer.read_uint8();
+            keyNode = deserializer.read_uint8();
+        }
+
+    private:
+
+        /**
+         * Provides the index of a column among the columns that have zone maps
+         * @param column The index of the column. columns() for the number of columns that have zone maps
+         */
+        size_t _zoneMapIndex(size_t column) const {
+            size_t index = 0;
+            for (size_t i = 0; i < column; i++) {
+                if (hasZoneMaps(i)) { index++; }
+            }
+
+            return index;
         }
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+// Language: C++
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Epoch based reclamation for data structures that are read without locks. Readers announce the epoch they
+ * started reading in, and memory that writers unlink is only freed once every reader that could still see it
+ * has finished. Shared by the whole process.
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class Epochs {
+    public:
+
+        /** The number of threads that can be reading at the same time */
+        static const size_t MAX_READERS = 1024;
+
+        /** The number of retired objects that are collected before trying to free them */
+        static const size_t RECLAIM_THRESHOLD = 64;
+
+        /** The current epoch */
+        std::atomic<uint64_t> _epoch;
+
+        /** The epoch each reader slot started reading in. 0 if the slot is not reading */
+        std::atomic<uint64_t> _readers[MAX_READERS];
+
+        /** True for slots that belong to a thread */
+        std::atomic<bool> _claimed[MAX_READERS];
+
+        /** Objects that have been unlinked, with the epoch they were unlinked in and how to free them */
+        std::vector<std::pair<uint64_t, std::function<void()>>> _retired;
+
+        /** Mutex for _retired */
+        std::mutex _retiredMutex;
+
+        /** Default constructor */
+        Epochs() : _epoch(1) {
+            for (size_t i = 0; i < MAX_READERS; i++) {
+                _readers[i] = 0;
+                _claimed[i] = false;
+            }
+        }
+
+        ~Epochs() {
+            for (auto& retired : _retired) {
+                retired.second();
+            }
+        }
+
+        /** Provides the epochs for this process. Never destroyed, since detached threads may read until the very end */
+        static Epochs& shared() {
+            static Epochs* epochs = new Epochs();
+            return *epochs;
+        }
+
+        /**
+         * The reader slot of a thread. The slot is claimed the first time the thread reads and released when the
+         * thread exits. Reads can nest, only the outermost one announces an epoch
+         */
+        class Slot {
+            public:
+
+                /** The index of the slot */
+                size_t index;
+
+                /** The number of nested reads the thread is in */
+                size_t depth = 0;
+
+                /** Claims a free slot */
+                Slot() {
+                    Epochs& epochs = Epochs::shared();
+                    for (size_t i = 0; ; i = (i + 1) % MAX_READERS) {
+                        bool expected = false;
+                        if (!epochs._claimed[i] && epochs._claimed[i].compare_exchange_strong(expected, true)) {
+                            index = i;
+                            return;
+                        }
+
+                        if (i == MAX_READERS - 1) { std::this_thread::yield(); }
+                    }
+                }
+
+                ~Slot() { Epochs::shared()._claimed[index] = false; }
+        };
+
+        /** Provides the reader slot of the calling thread */
+        static Slot& _slot() {
+            static thread_local Slot slot;
+            return slot;
+        }
+
+        /** Starts a read. Objects retired from now on are not freed until the read ends */
+        void enter() {
+            Slot& slot = _slot();
+            if (slot.depth++) { return; }
+
+            // Make sure that a writer that advanced the epoch before the announcement was seen sees the reader
+            uint64_t epoch;
+            do {
+                epoch = _epoch.load();
+                _readers[slot.index].store(epoch);
+            } while (_epoch.load() != epoch);
+        }
+
+        /** Ends a read */
+        void exit() {
+            Slot& slot = _slot();
+            if (--slot.depth) { return; }
+
+            _readers[slot.index].store(0);
+        }
+
+        /**
+         * Frees an object once no reader can still be looking at it. The object must already be unreachable
+         * for new readers
+         * @param free Frees the object
+         */
+        void retire(std::function<void()> free) {
+            std::lock_guard<std::mutex> lock(_retiredMutex);
+            _retired.push_back(std::make_pair(_epoch.load(), free));
+
+            if (_retired.size() >= RECLAIM_THRESHOLD) { _reclaim(); }
+        }
+
+        /** Frees all of the retired objects that no reader can see */
+        void reclaim() {
+            std::lock_guard<std::mutex> lock(_retiredMutex);
+            _reclaim();
+        }
+
+        /** Frees all of the retired objects that no reader can see. The retired mutex must be held */
+        void _reclaim() {
+            uint64_t oldest = _epoch.fetch_add(1) + 1;
+            for (size_t i = 0; i < MAX_READERS; i++) {
+                uint64_t reader = _readers[i].load();
+                if (reader && reader < oldest) { oldest = reader; }
+            }
+
+            size_t kept = 0;
+            for (size_t i = 0; i < _retired.size(); i++) {
+                if (_retired[i].first < oldest) {
+                    _retired[i].second();
+                } else {
+                    _retired[kept++] = std::move(_retired[i]);
+                }
+            }
+
+            _retired.resize(kept);
+        }
+};
+
+/**
+ * Keeps the calling thread inside of a read for as long as it is alive
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class EpochGuard {
+    public:
+
+        /** Starts the read */
+        EpochGuard() { Epochs::shared().enter(); }
+
+        /** Ends the read */
+        ~EpochGuard() { Epochs::shared().exit(); }
+};
@@ -2,184 +2,1184 @@
 
 // Language: C++
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <set>
 #include <thread>
+#include <vector>
 
 #include "../network/client.h"
+#include "../utils/codec.h"
+#include "../utils/fingerprint.h"
 #include "../utils/key.h"
+#include "../utils/workers.h"
+#include "../utils/datastructures/element_column.h"
 #include "dataframe_description.h"
+#include "byte_array.h"
+#include "remote_cache.h"
+#include "latency_window.h"
+#include "key_index.h"
+#include "content_table.h"
+#include "chunk_budget.h"
 
 /**
- * A byte array with a length and contents
+ * An object wrapper a std::atomic that says if a key is ready
  * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
  */
-class ByteArray: public Object {
+class Ready: public Object {
+    public:
+        std::atomic<bool> isReady;
+
+        /** Default constructor */
+        Ready() : isReady(false) {}
+};
+
+/**
+ * What the compressed tier of a store holds and what reading from it has cost
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class ColdTierReport: public Object {
     public:
 
-        /** The contents of the buffer */
-        const char* contents;
+        /** The number of values that are stored uncompressed */
+        size_t hotValues = 0;
+
+        /** The number of bytes that the uncompressed values take up */
+        size_t hotBytes = 0;
+
+        /** The number of values that are stored compressed */
+        size_t coldValues = 0;
+
+        /** The number of bytes that the compressed values take up */
+        size_t coldBytes = 0;
+
+        /** The number of bytes that the compressed values would take up uncompressed */
+        size_t coldOriginalBytes = 0;
+
+        /** The number of values that have been compressed */
+        size_t frozen = 0;
+
+        /** The number of compressed values that have been decompressed because they were read */
+        size_t thaws = 0;
+
+        /** The total time spent decompressing values, in microseconds */
+        uint64_t thawMicros = 0;
+
+        /** Provides the number of bytes that the compressed tier saves */
+        size_t savedBytes() const { return coldOriginalBytes - coldBytes; }
+
+        /** Provides the average time it took to decompress a value that was read, in microseconds */
+        uint64_t averageThawMicros() const { return thaws ? thawMicros / thaws : 0; }
+
+        /** Describes the report in a human readable form */
+        String* describe() const {
+            return StrBuff().c("hot: ").c(hotValues).c(" values in ").c(hotBytes).c(" bytes, cold: ")
+                            .c(coldValues).c(" values in ").c(coldBytes).c(" bytes (").c(coldOriginalBytes)
+                            .c(" uncompressed, ").c(savedBytes()).c(" saved), thaws: ").c(thaws)
+                            .c(" averaging ").c((size_t)averageThawMicros()).c("us").get();
+        }
+};
+
+/**
+ * A key to byte array store. All arrays are owned by the store
+ * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
+ */
+class KBStore {
+    public:
+        /** The index where all of the bytes are stored. Read without locks */
+        KeyIndex _index;
+
+        /** The unique bodies of the values on this node, so that values with the same bytes share them */
+        ContentTable _contents;
+
+        /** Statuses of keys that are used for waitAndGet. This prevents deadlocks */
+        Map _statuses;
+
+        /** Mutex for _statuses */
+        std::mutex _statusMutex;
+
+        /** The client used to talk to other KBstores */
+        Client _client;
+
+        /** The thread that is listening for new connections */
+        std::thread _listeningThread;
+
+        /** The last version that was given to a value stored on this node */
+        std::atomic<uint64_t> _lastVersion;
+
+        /** Copies of values from other nodes that have already been fetched */
+        RemoteCache _cache;
+
+        /** How often expired values are swept out of the store, in milliseconds */
+        static const uint64_t SWEEP_INTERVAL = 1000;
+
+        /** The last time expired values were swept out of the store */
+        uint64_t _lastSweep = 0;
+
+        /** The percentile of recent chunk read latencies after which a hedged read is sent to another replica */
+        constexpr static double HEDGE_PERCENTILE = 0.95;
+
+        /** The latencies of recent remote chunk reads */
+        LatencyWindow _latencies;
+
+        /** The number of reads that are in flight to each node. Used to pick the least loaded replica */
+        std::atomic<uint32_t> _inFlight[Key::MAX_NODES];
+
+        /** The number of reads of replicated chunks that are still running in the background */
+        std::atomic<size_t> _racing;
+
+        /** The number of hedged reads that have been sent */
+        std::atomic<size_t> hedges;
+
+        /** How often values are checked for whether they have gone cold, in milliseconds */
+        static const uint64_t FREEZE_INTERVAL = 1000;
+
+        /** How long a value has to go unread before it is compressed by default, in milliseconds */
+        static const uint64_t DEFAULT_COLD_AFTER = 30000;
+
+        /** The smallest value that is worth compressing */
+        static const size_t MIN_COLD_SIZE = 1024;
+
+        /** How long a value has to go unread before it is compressed, in milliseconds. 0 to never compress values */
+        std::atomic<uint64_t> _coldAfter;
+
+        /** The most values that are compressed while a single read of the index is kept open */
+        static const size_t FREEZE_BATCH = 64;
+
+        /** The thread that compresses cold values, so that the listening thread never waits on it */
+        std::thread _freezerThread;
+
+        /** True once the freezer thread should exit */
+        bool _stopFreezing = false;
+
+        /** Mutex for _stopFreezing */
+        std::mutex _freezerMutex;
+
+        /** Signalled when the freezer thread should exit */
+        std::condition_variable _freezerStopped;
+
+        /** The number of values that have been compressed */
+        std::atomic<size_t> _frozen;
+
+        /** The number of compressed values that have been decompressed because they were read */
+        std::atomic<size_t> _thaws;
+
+        /** The total time spent decompressing values, in microseconds */
+        std::atomic<uint64_t> _thawMicros;
+
+        /** The number of fingerprints of sent bodies that are remembered before they are forgotten */
+        static const size_t MAX_SENT_CONTENT = 4096;
+
+        /** The fingerprints of the bodies this node has put on other nodes, with the node they were put on */
+        std::set<std::pair<size_t, Fingerprint>> _sentContent;
+
+        /** Mutex for _sentContent */
+        std::mutex _sentMutex;
+
+        /** Passed as the expected version of a put that stores its value whatever version is there */
+        static const uint64_t ANY_VERSION = UINT64_MAX;
+
+        /** The number of remote puts that did not have to send their body since the home node already had it */
+        std::atomic<size_t> skippedTransfers;
+
+        /** The number of chunks a scan of a chunked column reads ahead of itself by default */
+        static const size_t DEFAULT_READ_AHEAD = 2;
+
+        /** The number of chunks a scan of a chunked column reads ahead of itself. 0 to not read ahead */
+        std::atomic<size_t> _readAhead;
+
+        /** The number of chunks that have been read ahead of a scan */
+        std::atomic<size_t> readAheads;
+
+        /** The number of chunks that were read ahead of a scan and then used by it */
+        std::atomic<size_t> readAheadHits;
+
+        /** The budget for the chunks that the columns of dataframes read on this node have deserialized */
+        ChunkBudget chunkBudget;
+
+        /** The most chunks that are read ahead at the same time on this node, across every scan */
+        static const size_t READ_AHEAD_THREADS = 8;
+
+        /**
+         * The threads that read chunks ahead of the scans on this node. Shared by every column, so that the number of
+         * threads does not grow with the number of columns or dataframes being read
+         */
+        Workers readAheadWorkers;
+
+        /**
+         * Evaluates a filter against the values stored on this node by reading the request and writing the reply. Set
+         * by the layer above, since the store does not know what its values hold
+         */
+        std::function<void(Deserializer&, Serializer&)> _filter;
+
+        /** The number of filters that were sent to other nodes */
+        std::atomic<size_t> filters;
+
+        /** The number of bytes that other nodes replied to filters with */
+        std::atomic<size_t> filteredBytes;
+
+        /**
+         * Runs this node's part of a distributed map by reading the request and writing the reply. Set by the layer
+         * above, like _filter
+         */
+        std::function<void(Deserializer&, Serializer&)> _mapper;
+
+        /**
+         * Replies to a get of a dataframe's description along with chunks that are stored on this node by reading the
+         * request and writing the reply. Set by the layer above, like _filter
+         */
+        std::function<void(Deserializer&, Serializer&)> _dataframeGetter;
+
+        /** The number of nodes in the cluster the last time it was checked */
+        size_t _knownNodes = 0;
+
+        /**
+         * Called from the listening thread with the new number of nodes whenever nodes join the cluster. Set by the
+         * layer above, which decides what moves to the new nodes
+         */
+        std::function<void(size_t)> _membershipChanged;
+
+        /** Mutex for _membershipChanged, so that it is never called once it is cleared */
+        std::mutex _membershipMutex;
+
+        /**
+         * Default constructor
+         * @param ip The IP that the client is reachable at
+         * @param handler The handler for messages. Owns the handler
+         * @param serverIP The IP of the rendezvous server
+         * @param serverPort The port of the rendezvous server
+         */
+        KBStore(in_addr_t ip, uint16_t port, in_addr_t serverIP, uint16_t serverPort) : _client(ip, port, new KBStoreMessageHander(*this)), _lastVersion(0),
+                                                                                             _racing(0), hedges(0),
+                                                                                             _coldAfter(DEFAULT_COLD_AFTER),
+                                                                                             _frozen(0), _thaws(0), _thawMicros(0),
+                                                                                             skippedTransfers(0), _readAhead(DEFAULT_READ_AHEAD),
+                                                                                             readAheads(0), readAheadHits(0),
+                                                                                             readAheadWorkers(READ_AHEAD_THREADS), filters(0),
+                                                                                             filteredBytes(0) {
+            for (size_t i = 0; i < Key::MAX_NODES; i++) {
+                _inFlight[i] = 0;
+            }
+
+            _client.connect(serverIP, serverPort);
+
+            _listeningThread = std::thread([&] {
+                while (_client.connected()) {
+                    _client.poll();
+                    _maintain();
+                }
+            });
+
+            _freezerThread = std::thread([this] { _runFreezer(); });
+        }
+
+        ~KBStore() {
+            {
+                std::lock_guard<std::mutex> lock(_freezerMutex);
+                _stopFreezing = true;
+            }
+
+            _freezerStopped.notify_all();
+            _freezerThread.join();
 
-        /** The length of the buffer */
-        size_t length;
+            // Reads that lost a hedge race still finish in the background
+            while (_racing) { std::this_thread::yield(); }
 
-        /** True if this byte array owns its data */
-        bool _ownsData;
+            _listeningThread.join();
+
+            std::vector<Entry*>& statusEntries = _statuses.entrySet();
+            for (size_t i = 0; i < _statuses.get_size(); i++) {
+                delete statusEntries[i]->key;
+                delete statusEntries[i]->value;
+            }
+        }
+
+        /**
+         * Retrieves the buffer with the given key from the store. If the
+         * value does not exist, nullptr is returned. The bytes stay valid even if the value is later removed.
+         * @param key The key of the buffer to return
+         * @return Returns the byte array. This byte array is unowned.
+         */
+        ByteArray* get(Key& key) {
+            if (key._node == _client.this_node()) {
+                return _getLocal(key);
+            } else {
+                return _get(key, GET);
+            }
+        }
+
+        /**
+         * Retrieves the buffer with the given key from the store only if it changed since a version that was already read
+         * @param key The key of the buffer to return
+         * @param version The version that was already read. 0 to return any version
+         * @return The byte array, or nullptr if the value does not exist or is not newer than the version. Unowned
+         */
+        ByteArray* getIfNewer(Key& key, uint64_t version) {
+            if (key._node == _client.this_node()) {
+                return _getLocal(key, version);
+            } else {
+                Serializer serializer;
+                serializer.write(version);
+                return _get(key, GET_IF_NEWER, serializer);
+            }
+        }
+
+        /**
+         * Provides the current version of a value stored on this node
+         * @param key The key of the value
+         * @return The version, or 0 if there is no live value
+         */
+        uint64_t _versionLocal(Key& key) {
+            EpochGuard guard;
+
+            ByteArray* existing = _index.get(key);
+            return existing && !_expired(existing) ? existing->version : 0;
+        }
+
+        /**
+         * Retrieves a view of a value stored on this node without taking any lock. Compressed values are decompressed
+         * @param key The key of the value
+         * @param newerThan Optional. Only values with a newer version than this are returned
+         * @return A view of the value that stays valid after the value is removed, or nullptr if there is no live value
+         */
+        ByteArray* _getLocal(Key& key, uint64_t newerThan = 0) {
+            EpochGuard guard;
+
+            ByteArray* existing = _index.get(key);
+            if (!existing || _expired(existing) || existing->version <= newerThan) { return nullptr; }
+
+            // Only written when it is out of date so that readers of a hot value do not fight over it
+            uint64_t now = _now();
+            if (now - existing->lastAccess.load(std::memory_order_relaxed) >= FREEZE_INTERVAL) {
+                existing->lastAccess.store(now, std::memory_order_relaxed);
+            }
+
+            if (existing->compressed) { return _thaw(key, existing); }
+            return existing->share();
+        }
+
+        /**
+         * Decompresses a value that was read and stores it uncompressed again, since it is no longer cold. The
+         * caller must be inside of an EpochGuard
+         * @param key The key of the value
+         * @param cold The compressed value
+         * @return A view of the decompressed value
+         */
+        ByteArray* _thaw(Key& key, ByteArray* cold) {
+            auto start = std::chrono::steady_clock::now();
+
+            size_t length;
+            char* contents = Codec::decompress(cold->contents, cold->length, length);
+
+            ByteArray* hot = _contents.intern(ByteArray::shared(contents, length));
+            hot->version = cold->version;
+            hot->expiresAt = cold->expiresAt.load();
+            hot->lastAccess = cold->lastAccess.load();
+
+            // A writer may have replaced the value in the meantime, in which case the view is all that is kept
+            ByteArray* view = hot->share();
+            if (_index.replace(key, cold, hot)) {
+                // An expire that landed after the time was copied wrote it onto the cold value only
+                hot->expiresAt = cold->expiresAt.load();
+            } else {
+                delete hot;
+            }
+
+            _thaws++;
+            _thawMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            return view;
+        }
+
+        /**
+         * Retrieves the buffer with the given key from the store. This call will block until the value exists
+         * @param key The key of the buffer to return
+         */
+        ByteArray* waitAndGet(Key& key) {
+            if (key._node == _client.this_node()) {
+                while (true) {
+                    // Values that are already stored are read without the lock, like any other local read
+                    ByteArray* bytes = _getLocal(key);
+                    if (bytes) { return bytes; }
+
+                    // Checked again under the lock, since a put that lands in between would never mark it ready
+                    _statusMutex.lock();
+                    bytes = _getLocal(key);
+                    if (bytes) {
+                        _statusMutex.unlock();
+                        return bytes;
+                    }
+
+                    Ready* ready = dynamic_cast<Ready*>(_statuses.get(&key));
+                    if (!ready) {
+                        ready = new Ready();
+                        _statuses.put(key.clone(), ready);
+                    }
+
+                    _statusMutex.unlock();
+
+                    // The value may be removed again before it is read, in which case keep waiting
+                    while (ready->isReady == false) {}
+                }
+            } else {
+                return _get(key, GET_AND_WAIT);
+            }
+        }
+
+        /**
+         * Retrieves the buffer with the given key from the store, blocking until it exists. Values that live on other
+         * nodes are served from the remote cache if it holds a copy that is at least as new as the given version,
+         * otherwise they are fetched and cached.
+         * @param key The key of the buffer to return
+         * @param version The version of the value the caller expects. 0 if unknown, which bypasses the cache
+         */
+        ByteArray* waitAndGet(Key& key, uint64_t version) {
+            if (key._node == _client.this_node() || !version) { return waitAndGet(key); }
+
+            ByteArray* cached = _cache.get(key, version);
+            if (cached) { return cached; }
+
+            return _fetch(key, version);
+        }
+
+        /**
+         * Retrieves a replicated value from one of its copies, blocking until it exists. See _getCopy for which copy
+         * is read
+         * @param copies The keys of the copies of the value
+         * @param versions The version of each copy
+         * @param count The number of copies
+         */
+        ByteArray* waitAndGet(Key** copies, uint64_t* versions, size_t count) { return _getCopy(copies, versions, count, true); }
+
+        /**
+         * Retrieves a replicated value from one of its copies the way waitAndGet does, without waiting for the copy
+         * that is read to exist
+         * @param copies The keys of the copies of the value
+         * @param versions The version of each copy
+         * @param count The number of copies
+         * @return The value, or nullptr if the copy that was read does not exist
+         */
+        ByteArray* get(Key** copies, uint64_t* versions, size_t count) { return _getCopy(copies, versions, count, false); }
+
+        /**
+         * Retrieves a replicated value from one of its copies. A local copy is used if there is one, otherwise the
+         * least loaded node is asked for it. If that read takes longer than most recent reads, a hedged read is sent
+         * to a second copy and whichever answers first is used.
+         * @param copies The keys of the copies of the value
+         * @param versions The version of each copy
+         * @param count The number of copies
+         * @param wait Whether to block until the copy that is read exists
+         * @return The value, or nullptr if it does not exist and wait is false
+         */
+        ByteArray* _getCopy(Key** copies, uint64_t* versions, size_t count, bool wait) {
+            KBMessageType type = wait ? GET_AND_WAIT : GET;
+            if (count == 1 && wait) { return waitAndGet(*copies[0], versions[0]); }
+
+            for (size_t i = 0; i < count; i++) {
+                if (copies[i]->getNode() == _client.this_node()) { return wait ? waitAndGet(*copies[i]) : _getLocal(*copies[i]); }
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                ByteArray* cached = versions[i] ? _cache.get(*copies[i], versions[i]) : nullptr;
+                if (cached) { return cached; }
+            }
+
+            size_t first = _leastLoaded(copies, count, count);
+            uint64_t threshold = _latencies.percentile(HEDGE_PERCENTILE);
+            if (!threshold || count == 1) { return _fetch(*copies[first], versions[first], type); }
+
+            // Both reads run in the background so that the slower one can be abandoned
+            struct Race {
+                std::mutex mutex;
+                std::condition_variable finished;
+                ByteArray* winner = nullptr;
+                size_t running = 0;
+            };
+
+            std::shared_ptr<Race> race = std::make_shared<Race>();
+            auto run = [this, race, type](Key* key, uint64_t version) {
+                ByteArray* bytes = _fetch(*key, version, type);
+                {
+                    std::lock_guard<std::mutex> lock(race->mutex);
+                    race->running--;
+                    if (!race->winner) { std::swap(race->winner, bytes); }
+                }
+
+                race->finished.notify_all();
+                delete bytes;
+                delete key;
+                _racing--;
+            };
+
+            // A read that finds nothing only ends the race once every read has
+            auto done = [&] { return race->winner != nullptr || !race->running; };
+            std::unique_lock<std::mutex> lock(race->mutex);
+            race->running++;
+            _racing++;
+            std::thread(run, (Key*)copies[first]->clone(), versions[first]).detach();
+
+            if (!race->finished.wait_for(lock, std::chrono::microseconds(threshold), done)) {
+                size_t second = _leastLoaded(copies, count, first);
+                hedges++;
+                race->running++;
+                _racing++;
+                std::thread(run, (Key*)copies[second]->clone(), versions[second]).detach();
+            }
+
+            race->finished.wait(lock, done);
+            return race->winner;
+        }
+
+        /**
+         * Picks the copy on the node with the fewest reads in flight. Ties go to the first copy after an offset
+         * that depends on this node, so that readers on different nodes spread out over the copies
+         * @param copies The keys of the copies
+         * @param count The number of copies
+         * @param skip A copy that should not be picked. count to not skip any
+         * @return The index of the picked copy
+         */
+        size_t _leastLoaded(Key** copies, size_t count, size_t skip) {
+            size_t best = count;
+            for (size_t i = 0; i < count; i++) {
+                size_t copy = (_client.this_node() + i) % count;
+                if (copy == skip) { continue; }
+
+                if (best == count || _inFlight[copies[copy]->getNode()] < _inFlight[copies[best]->getNode()]) {
+                    best = copy;
+                }
+            }
+
+            return best;
+        }
+
+        /**
+         * Reads a value from another node. The latency of the read is recorded and the value is cached
+         * @param key The key of the value
+         * @param version The version of the value the caller expects
+         * @param type GET_AND_WAIT to block until the value exists, or GET to not
+         */
+        ByteArray* _fetch(Key& key, uint64_t version, KBMessageType type = GET_AND_WAIT) {
+            auto start = std::chrono::steady_clock::now();
+            _inFlight[key.getNode()]++;
+
+            ByteArray* bytes = _get(key, type);
+
+            _inFlight[key.getNode()]--;
+            _latencies.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+            if (bytes && bytes->version >= version) { _cache.put(key, bytes->contents, bytes->length, bytes->version); }
+            return bytes;
+        }
+
+        /**
+         * Puts a series of bytes inside of the store
+         * @param contents The buffer to put into the store
+         * @param length The length of the bytes in the buffer
+         * @param key The key to store the buffer under
+         * @return The version that the home node gave the value
+         */
+        uint64_t put(const char *contents, size_t length, Key& key) {
+            if (key._node == _client.this_node()) {
+                char* newBuffer = new char[length];
+                memcpy(newBuffer, contents, sizeof(char) * length);
+
+                return _putLocal(ByteArray::shared(newBuffer, length), key);
+            } else {
+                return _put(key, contents, length);
+            }
+        }
+
+        /**
+         * Puts a series of bytes inside of the store only if the value under the key is still at the version the
+         * caller expects, so that concurrent writers do not overwrite each other's changes
+         * @param contents The buffer to put into the store
+         * @param length The length of the bytes in the buffer
+         * @param key The key to store the buffer under
+         * @param expected The version the value must be at. 0 if the key must not have a value
+         * @return The version that the home node gave the value, or 0 if the value was at another version
+         */
+        uint64_t putIfVersion(const char* contents, size_t length, Key& key, uint64_t expected) {
+            if (key._node == _client.this_node()) {
+                char* newBuffer = new char[length];
+                memcpy(newBuffer, contents, sizeof(char) * length);
+
+                return _putBody(_contents.intern(ByteArray::shared(newBuffer, length)), key, expected);
+            } else {
+                const char* name = key.getName();
+                String nameString(name ? name : "");
+
+                Serializer serializer;
+                serializer.write(&nameString);
+                serializer.write(expected);
+                serializer._write(contents, length);
+
+                return _request(key, PUT_IF_VERSION, serializer);
+            }
+        }
+
+        /**
+         * Puts the contents of a serializer inside of the store. If the key is homed on this node, the serializer's
+         * buffer is stored as is instead of being copied and the serializer is left empty
+         * @param serializer The serializer with the bytes to store
+         * @param key The key to store the bytes under
+         * @return The version that the home node gave the value
+         */
+        uint64_t put(Serializer& serializer, Key& key) {
+            if (key._node == _client.this_node()) {
+                size_t length = serializer.getSize();
+                return _putLocal(ByteArray::shared(serializer.steal(), length), key);
+            } else {
+                return _put(key, serializer.getBuffer(), serializer.getSize());
+            }
+        }
+
+        /**
+         * Stores bytes on this node. If a value with the same bytes is already stored, its body is shared instead
+         * @param bytes The bytes to store. Must have a shared buffer. The store takes ownership of them
+         * @param key The key to store the bytes under. Must be homed on this node
+         * @return The version the value was given
+         */
+        uint64_t _putLocal(ByteArray* bytes, Key& key) {
+            return _putBody(_contents.intern(bytes), key);
+        }
+
+        /**
+         * Stores a value under a key on this node if a body with the given fingerprint is already stored here
+         * @param fingerprint The fingerprint of the body
+         * @param length The length of the body
+         * @param key The key to store the value under. Must be homed on this node
+         * @return The version the value was given, or 0 if the body is not stored here
+         */
+        uint64_t _putIfContent(const Fingerprint& fingerprint, size_t length, Key& key) {
+            ByteArray* bytes = _contents.find(fingerprint, length);
+            if (!bytes) { return 0; }
+
+            _contents.deduplicated++;
+            _contents.deduplicatedBytes += length;
+            return _putBody(bytes, key);
+        }
+
+        /**
+         * Stores bytes on this node as they are
+         * @param bytes The bytes to store. The store takes ownership of them
+         * @param key The key to store the bytes under. Must be homed on this node
+         * @param expected Optional. The version the value must be at for the bytes to be stored. 0 if the key must
+         *                 not have a value
+         * @return The version the value was given, or 0 if the value was at another version
+         */
+        uint64_t _putBody(ByteArray* bytes, Key& key, uint64_t expected = ANY_VERSION) {
+            _statusMutex.lock();
+
+            // Every write to the index that changes a version holds the status mutex, so the version can not change
+            // between the check and the put
+            if (expected != ANY_VERSION && _versionLocal(key) != expected) {
+                _statusMutex.unlock();
+                delete bytes;
+                return 0;
+            }
+
+            bytes->version = ++_lastVersion;
+            bytes->lastAccess = _now();
+            _index.put(key, bytes);
+
+            // Interned under the lock, so that a remove of the key that races this put can not forget the name of a
+            // value that is stored
+            if (key.getNameAsString()) { KeyNames::shared().intern(key.getId(), key.getName()); }
+
+            Ready* ready = dynamic_cast<Ready*>(_statuses.get(&key));
+            if (ready) { ready->isReady = true; }
+
+            _statusMutex.unlock();
+            return bytes->version;
+        }
+
+        /**
+         * Removes the value with the given key from the store. Readers that already have the value keep a valid copy.
+         * The name of the key is forgotten by the node that stored the value. Other processes that wrote or read the
+         * key keep it interned, since they may still hold keys made from its id
+         * @param key The key of the value to remove
+         * @return true if there was a value to remove
+         */
+        bool remove(Key& key) {
+            if (key._node == _client.this_node()) {
+                _statusMutex.lock();
+
+                bool removed = _index.remove(key);
+                Ready* ready = dynamic_cast<Ready*>(_statuses.get(&key));
+                if (ready) { ready->isReady = false; }
+
+                // The name is only needed while there is a value under the key. Every put holds the status mutex, so
+                // the key is still absent here
+                if (removed) { KeyNames::shared().forget(key.getId()); }
+
+                _statusMutex.unlock();
+                return removed;
+            } else {
+                _cache.invalidate(key);
+
+                Serializer serializer;
+                return _request(key, REMOVE, serializer) != 0;
+            }
+        }
+
+        /**
+         * Makes the value with the given key expire after some time. Once expired it is treated as if it was removed
+         * @param key The key of the value
+         * @param ttl The number of milliseconds from now that the value expires
+         * @return true if there was a value to expire
+         */
+        bool expire(Key& key, uint64_t ttl) {
+            if (key._node == _client.this_node()) {
+                EpochGuard guard;
+
+                uint64_t expiresAt = _now() + ttl;
+                ByteArray* existing = _index.get(key);
+                bool found = existing != nullptr;
+
+                // A compress or a thaw may swap the value for a copy at any time. It copies the time again once the copy
+                // is stored, and the time is written onto the copy here if it was stored first, so the time is never lost
+                while (existing) {
+                    existing->expiresAt = expiresAt;
+                    ByteArray* current = _index.get(key);
+                    if (current == existing) { break; }
+                    existing = current;
+                }
+
+                return found;
+            } else {
+                Serializer serializer;
+                serializer.write(ttl);
+                return _request(key, EXPIRE, serializer) != 0;
+            }
+        }
+
+        /**
+         * Removes every value whose key starts with the given prefix from every node in the cluster
+         * @param prefix The prefix of the keys to remove
+         * @return The number of values that were removed
+         */
+        size_t removePrefix(const char* prefix) {
+            size_t removed = 0;
+            for (size_t node = 0; node < nodes(); node++) {
+                if (node == _client.this_node()) {
+                    removed += _removeLocalPrefix(prefix);
+                } else {
+                    String prefixString(prefix);
+                    Serializer serializer;
+                    serializer.write(&prefixString);
+                    removed += _request(node, REMOVE_PREFIX, serializer);
+                }
+            }
+
+            return removed;
+        }
+
+        /**
+         * Lists the keys in the whole cluster that start with the given prefix. Every node lists its own keys at the
+         * same time. Keys that the store made for itself, like the keys of chunks, are left out
+         * @param prefix The prefix of the keys to list
+         * @return The keys with their names and home nodes. The caller owns them
+         */
+        std::vector<Key*> scan(const char* prefix) {
+            std::vector<std::vector<Key*>> found(nodes());
+            std::vector<std::thread> scans;
+            for (size_t node = 0; node < found.size(); node++) {
+                if (node != _client.this_node()) {
+                    scans.emplace_back([this, &found, node, prefix] { found[node] = _scanRemote(node, prefix); });
+                }
+            }
+
+            if (_client.this_node() < found.size()) { found[_client.this_node()] = _scanLocal(prefix); }
+
+            for (std::thread& scan : scans) {
+                scan.join();
+            }
+
+            std::vector<Key*> keys;
+            for (std::vector<Key*>& nodeKeys : found) {
+                keys.insert(keys.end(), nodeKeys.begin(), nodeKeys.end());
+            }
+
+            return keys;
+        }
+
+        /**
+         * Lists the live keys on this node that start with the given prefix, leaving out the keys the store made
+         * for itself
+         * @param prefix The prefix of the keys to list
+         * @return The keys with their names. The caller owns them
+         */
+        std::vector<Key*> _scanLocal(const char* prefix) {
+            size_t length = strlen(prefix);
+            std::vector<Key*> keys;
+
+            EpochGuard guard;
+            _index.forEach([&](Key* key, ByteArray* value) {
+                const char* name = key->getName();
+                if (name && !strncmp(name, prefix, length) && !strchr(name, Key::SEPARATOR) && !_expired(value)) {
+                    keys.push_back(new Key(name, key->getNode()));
+                }
+            });
+
+            return keys;
+        }
+
+        /**
+         * Lists the keys on another node that start with the given prefix
+         * @param node The node to list the keys of
+         * @param prefix The prefix of the keys to list
+         * @return The keys with their names. The caller owns them
+         */
+        std::vector<Key*> _scanRemote(size_t node, const char* prefix) {
+            String prefixString(prefix);
+            Serializer serializer;
+            serializer.write(&prefixString);
+
+            KBMessage message(SCAN, serializer.getBuffer(), serializer.getSize());
+            RemoteClient* client = _client.send(node, message);
+
+            Message* m = client->recieve();
+            Deserializer deserializer = m->deserializer();
+
+            KBMessage read;
+            read.deserialize(deserializer);
+            assert(read.getKbMessageType() == RESPONSE_DATA);
+
+            Deserializer reply(read.length(), read.getData());
+            std::vector<Key*> keys(reply.read_uint64());
+            for (size_t i = 0; i < keys.size(); i++) {
+                String* name = reply.read_string();
+                keys[i] = new Key(name, node);
+            }
+
+            delete m;
+            delete client;
+            return keys;
+        }
+
+        /**
+         * Removes every value on this node whose key starts with the given prefix
+         * @param prefix The prefix of the keys to remove
+         * @return The number of values that were removed
+         */
+        size_t _removeLocalPrefix(const char* prefix) {
+            size_t length = strlen(prefix);
+            return _removeLocalWhere([&](Key* key, ByteArray* value) {
+                const char* name = key->getName();
+                return name && !strncmp(name, prefix, length);
+            });
+        }
+
+        /**
+         * Removes every value on this node that matches a condition
+         * @param condition Returns true if the value with the key should be removed
+         * @return The number of values that were removed
+         */
+        size_t _removeLocalWhere(std::function<bool(Key*, ByteArray*)> condition) {
+            std::vector<KeyId> matches;
+            {
+                EpochGuard guard;
+                _index.forEach([&](Key* key, ByteArray* value) {
+                    if (condition(key, value)) { matches.push_back(key->getId()); }
+                });
+            }
+
+            size_t removed = 0;
+            for (KeyId match : matches) {
+                Key key(match);
+                removed += remove(key);
+            }
+
+            return removed;
+        }
 
-        /** Default constructor */
-        ByteArray(const char *contents, size_t length, bool ownsData = true) : contents(contents), length(length), _ownsData(ownsData) {}
+        /**
+         * Performs periodic upkeep of the store, like sweeping out expired values. Called by the listening thread
+         */
+        void _maintain() {
+            uint64_t now = _now();
+            if (now - _lastSweep >= SWEEP_INTERVAL) {
+                _lastSweep = now;
+                _removeLocalWhere([&](Key* key, ByteArray* value) { return _expired(value); });
+                _contents.sweep();
+            }
 
-        virtual ~ByteArray() {
-            if (_ownsData) {
-                delete[] contents;
+            size_t clusterNodes = nodes();
+            if (clusterNodes != _knownNodes) {
+                _knownNodes = clusterNodes;
+                std::lock_guard<std::mutex> lock(_membershipMutex);
+                if (_membershipChanged) { _membershipChanged(clusterNodes); }
             }
         }
 
-};
+        /**
+         * Sets what happens when nodes join the cluster. It must return quickly, since it runs on the thread that
+         * accepts messages
+         * @param changed Called with the new number of nodes
+         */
+        void setMembershipListener(std::function<void(size_t)> changed) {
+            std::lock_guard<std::mutex> lock(_membershipMutex);
+            _membershipChanged = changed;
+        }
 
-/**
- * An object wrapper a std::atomic that says if a key is ready
- * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
- */
-class Ready: public Object {
-    public:
-        std::atomic<bool> isReady;
+        /**
+         * Changes how long values have to go unread before they are compressed
+         * @param coldAfter The time in milliseconds. 0 to never compress values
+         */
+        void setColdAfter(uint64_t coldAfter) { _coldAfter = coldAfter; }
 
-        /** Default constructor */
-        Ready() : isReady(false) {}
-};
+        /**
+         * Sets how many chunks a scan of a chunked column reads ahead of itself
+         * @param readAhead The number of chunks. 0 to not read ahead
+         */
+        void setReadAhead(size_t readAhead) { _readAhead = readAhead; }
 
-/**
- * A key to byte array store. All arrays are owned by the store
- * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
- */
-class KBStore {
-    public:
-        /** The map where all of the bytes are stored */
-        Map _map;
+        /**
+         * Sets how filters are evaluated against the values stored on this node
+         * @param filter Reads a filter request and writes the reply to it
+         */
+        void setFilter(std::function<void(Deserializer&, Serializer&)> filter) { _filter = filter; }
 
-        /** Statuses of keys that are used for waitAndGet. This prevents deadlocks */
-        Map _statuses;
+        /**
+         * Evaluates a filter on a node, so that only what matches it is sent back instead of the values it reads
+         * @param node The node to evaluate the filter on
+         * @param request The filter request
+         * @return The reply to the filter. The caller owns it
+         */
+        ByteArray* filter(size_t node, Serializer& request) {
+            if (node == _client.this_node()) { return _callLocal(_filter, request); }
 
-        /** Mutex for _statuses */
-        std::mutex _statusMutex;
+            ByteArray* reply = _call(node, FILTER, request);
+            filters++;
+            filteredBytes += reply->length;
+            return reply;
+        }
 
-        /** The client used to talk to other KBstores */
-        Client _client;
+        /**
+         * Sets how this node runs its part of a distributed map
+         * @param mapper Reads a map request and writes the reply to it
+         */
+        void setMapper(std::function<void(Deserializer&, Serializer&)> mapper) { _mapper = mapper; }
 
-        /** The thread that is listening for new connections */
-        std::thread _listeningThread;
+        /**
+         * Runs a node's part of a distributed map on that node
+         * @param node The node to run the map on
+         * @param request The map request
+         * @return The reply to the map. The caller owns it
+         */
+        ByteArray* mapOn(size_t node, Serializer& request) {
+            if (node == _client.this_node()) { return _callLocal(_mapper, request); }
+            return _call(node, DISTRIBUTED_MAP, request);
+        }
 
         /**
-         * Default constructor
-         * @param ip The IP that the client is reachable at
-         * @param handler The handler for messages. Owns the handler
-         * @param serverIP The IP of the rendezvous server
-         * @param serverPort The port of the rendezvous server
+         * Sets how this node replies to a get of a dataframe along with its chunks
+         * @param getter Reads a get request and writes the reply to it
          */
-        KBStore(in_addr_t ip, uint16_t port, in_addr_t serverIP, uint16_t serverPort) : _client(ip, port, new KBStoreMessageHander(*this)) {
-            _client.connect(serverIP, serverPort);
+        void setDataframeGetter(std::function<void(Deserializer&, Serializer&)> getter) { _dataframeGetter = getter; }
 
-            _listeningThread = std::thread([&] {
-                while (_client.connected()) {
-                    _client.poll();
-                }
-            });
+        /**
+         * Gets the description of a dataframe along with chunks that are stored on the same node, in one round trip
+         * @param node The node the description is stored on
+         * @param request The get request
+         * @return The reply to the get. The caller owns it
+         */
+        ByteArray* getDataframe(size_t node, Serializer& request) {
+            if (node == _client.this_node()) { return _callLocal(_dataframeGetter, request); }
+            return _call(node, GET_DATAFRAME, request);
         }
 
-        ~KBStore() {
-            _listeningThread.join();
-
-            std::vector<Entry*>& entries = _map.entrySet();
-            for (size_t i = 0; i < _map.get_size(); i++) {
-                delete entries[i]->key;
-                delete entries[i]->value;
-            }
+        /**
+         * Handles a request that the layer above defines on this node
+         * @param handler The handler of the request
+         * @param request The request
+         * @return The reply. The caller owns it
+         */
+        ByteArray* _callLocal(std::function<void(Deserializer&, Serializer&)>& handler, Serializer& request) {
+            Deserializer deserializer(request.getSize(), request.getBuffer());
+            Serializer reply;
+            handler(deserializer, reply);
 
-            std::vector<Entry*>& statusEntries = _statuses.entrySet();
-            for (size_t i = 0; i < _statuses.get_size(); i++) {
-                delete statusEntries[i]->key;
-                delete statusEntries[i]->value;
-            }
+            size_t length = reply.getSize();
+            return new ByteArray(reply.steal(), length);
         }
 
         /**
-         * Retrieves the buffer with the given key from the store. If the
-         * value does not exist, nullptr is returned. The buffer is owned by this store.
-         * @param key The key of the buffer to return
-         * @return Returns the byte array. This byte array is unowned.
+         * Sends a request that the layer above defines to another node and waits for the reply
+         * @param node The node to send the request to
+         * @param type The type of the request
+         * @param request The request
+         * @return The reply. The caller owns it
          */
-        ByteArray* get(Key& key) {
-            if (key._node == _client.this_node()) {
-                ByteArray* existing = (ByteArray*)_map.get(&key);
-                return existing ? new ByteArray(existing->contents, existing->length, false) : existing;
-            } else {
-                return _get(key, GET);
+        ByteArray* _call(size_t node, KBMessageType type, Serializer& request) {
+            KBMessage message(type, request.getBuffer(), request.getSize());
+            RemoteClient* client = _client.send(node, message);
+
+            Message* m = client->recieve();
+            Deserializer deserializer = m->deserializer();
+
+            KBMessage read;
+            read.deserialize(deserializer);
+            assert(read.getKbMessageType() == RESPONSE_DATA);
+
+            ByteArray* reply = new ByteArray(read.getData(), read.length());
+            read._data = nullptr;
+
+            delete m;
+            delete client;
+            return reply;
+        }
+
+        /** Provides the fraction of the chunks that were read ahead of a scan that the scan then used */
+        double readAheadHitRate() {
+            size_t issued = readAheads;
+            return issued ? (double)readAheadHits / issued : 0;
+        }
+
+        /** Compresses cold values every FREEZE_INTERVAL until the store is destroyed. Run by the freezer thread */
+        void _runFreezer() {
+            std::chrono::milliseconds interval((uint64_t)FREEZE_INTERVAL);
+            std::unique_lock<std::mutex> lock(_freezerMutex);
+            while (!_freezerStopped.wait_for(lock, interval, [&] { return _stopFreezing; })) {
+                if (!_coldAfter) { continue; }
+
+                lock.unlock();
+                _freeze(_now());
+                lock.lock();
             }
         }
 
         /**
-         * Retrieves the buffer with the given key from the store. This call will block until the value exists
-         * @param key The key of the buffer to return
+         * Compresses the values that have not been read for long enough, FREEZE_BATCH at a time. Every batch is read
+         * from the index again under its own guard, so that a pass over a large store never holds back reclaiming
+         * replaced values for longer than a batch takes
+         * @param now The current time on the steady clock in milliseconds
          */
-        ByteArray* waitAndGet(Key& key) {
-            if (key._node == _client.this_node()) {
-                _statusMutex.lock();
+        void _freeze(uint64_t now) {
+            std::vector<KeyId> cold;
+            {
+                EpochGuard guard;
+                _index.forEach([&](Key* key, ByteArray* value) {
+                    if (_isCold(value, now)) { cold.push_back(key->getId()); }
+                });
+            }
 
-                if (_map.contains_key(&key)) {
-                    _statusMutex.unlock();
-                    return get(key);
+            for (size_t start = 0; start < cold.size(); start += FREEZE_BATCH) {
+                {
+                    std::lock_guard<std::mutex> lock(_freezerMutex);
+                    if (_stopFreezing) { return; }
                 }
 
-                Ready* ready = dynamic_cast<Ready*>(_statuses.get(&key));
-                if (!ready) {
-                    ready = new Ready();
-                    _statuses.put(key.clone(), ready);
+                EpochGuard guard;
+                size_t end = std::min(cold.size(), start + FREEZE_BATCH);
+                for (size_t i = start; i < end; i++) {
+                    Key key(cold[i]);
+                    ByteArray* value = _index.get(key);
+                    if (value && _isCold(value, now)) { _compress(key, value); }
                 }
-
-                _statusMutex.unlock();
-                while (ready->isReady == false) {}
-                return get(key);
-            } else {
-                return _get(key, GET_AND_WAIT);
             }
         }
 
         /**
-         * Puts a series of bytes inside of the store
-         * @param contents The buffer to put into the store
-         * @param length The length of the bytes in the buffer
-         * @param key The key to store the buffer under
+         * Determines if a value should be compressed. Values whose body is in use elsewhere are not, since compressing
+         * each of the values that share a body would store it more than once
+         * @param value The stored value
+         * @param now The current time on the steady clock in milliseconds
          */
-        void put(const char *contents, size_t length, Key& key) {
-            if (key._node == _client.this_node()) {
+        bool _isCold(ByteArray* value, uint64_t now) {
+            return !value->compressed && value->length >= MIN_COLD_SIZE && now - value->lastAccess >= _coldAfter
+                   && value->_buffer.use_count() == 1;
+        }
 
-                _statusMutex.lock();
+        /**
+         * Replaces a value in the index with a compressed copy of it. Values are compressed with their bytes shuffled
+         * as Elements, since most values are chunks of Element columns, and otherwise as is. Values that do not shrink
+         * by at least an eighth are left alone. Must be called while the value is protected by an EpochGuard
+         * @param key The key of the value
+         * @param value The stored value
+         */
+        void _compress(Key& key, ByteArray* value) {
+            size_t length;
+            char* contents = Codec::compress(value->contents, value->length, sizeof(Element), length);
+            if (!contents) { contents = Codec::compress(value->contents, value->length, 1, length); }
+            if (!contents) { return; }
 
-                char* newBuffer = new char[length];
-                memcpy(newBuffer, contents, sizeof(char) * length);
-                _map.put(key.clone(), new ByteArray(newBuffer, length));
+            if (length > value->length - value->length / 8) {
+                delete[] contents;
+                return;
+            }
 
-                Ready* ready = dynamic_cast<Ready*>(_statuses.get(&key));
-                if (ready) { ready->isReady = true; }
+            ByteArray* compressed = ByteArray::shared(contents, length);
+            compressed->compressed = true;
+            compressed->version = value->version;
+            compressed->expiresAt = value->expiresAt.load();
+            compressed->lastAccess = value->lastAccess.load();
 
-                _statusMutex.unlock();
+            if (_index.replace(key, value, compressed)) {
+                // An expire that landed after the time was copied wrote it onto the old value only
+                compressed->expiresAt = value->expiresAt.load();
+                _frozen++;
             } else {
-                _put(key, contents, length);
+                delete compressed;
+            }
+        }
+
+        /** Reports how much memory the compressed tier saves and how long reading from it takes */
+        ColdTierReport coldTierReport() {
+            ColdTierReport report;
+            {
+                EpochGuard guard;
+                _index.forEach([&](Key* key, ByteArray* value) {
+                    if (value->compressed) {
+                        report.coldValues++;
+                        report.coldBytes += value->length;
+                        report.coldOriginalBytes += Codec::decompressedLength(value->contents);
+                    } else {
+                        report.hotValues++;
+                        report.hotBytes += value->length;
+                    }
+                });
             }
+
+            report.frozen = _frozen;
+            report.thaws = _thaws;
+            report.thawMicros = _thawMicros;
+            return report;
+        }
+
+        /** Determines if a stored value has expired */
+        bool _expired(ByteArray* value) { return value->expiresAt && value->expiresAt <= _now(); }
+
+        /** Provides the current time on the steady clock in milliseconds */
+        static uint64_t _now() {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
         }
 
         /**
-         * Puts the data in a remote KBStore
-         * @param key The key to put the data under
-         * @param contents The data to put
-         * @param length The length in bytes of the data
+         * Sends a request about a key to the key's home node and waits for its ACK
+         * @param key The key that the request is about
+         * @param type The type of the request
+         * @param serializer The contents of the request
+         * @return The number in the ACK
          */
-        void _put(Key& key, const char *contents, size_t length) {
-            Serializer serializer;
-            serializer.write(key);
-            serializer._write(contents, length);
+        uint64_t _request(Key& key, KBMessageType type, Serializer& serializer) {
+            return _request(key.getNode(), type, serializer, key.getId());
+        }
 
-            KBMessage message(PUT, serializer.getBuffer(), serializer.getSize());
-            RemoteClient* client = _client.send(key.getNode(), message);
+        /**
+         * Sends a request to another node and waits for its ACK. The ACK carries a single number
+         * @param node The node to send the request to
+         * @param type The type of the request
+         * @param serializer The contents of the request
+         * @param key Optional. The id of the key that the request is about
+         * @return The number in the ACK
+         */
+        uint64_t _request(size_t node, KBMessageType type, Serializer& serializer, KeyId key = 0) {
+            KBMessage message(type, serializer.getBuffer(), serializer.getSize(), key);
+            RemoteClient* client = _client.send(node, message);
 
             Message* m = client->recieve();
             Deserializer deserializer = m->deserializer();
@@ -188,21 +1188,97 @@ class KBStore {
             read.deserialize(deserializer);
             assert(read.getKbMessageType() == ACK);
 
+            Deserializer reply(read.length(), read.getData());
+            uint64_t result = reply.read_uint64();
+
             delete m;
             delete client;
+            return result;
+        }
+
+        /**
+         * Puts the data in a remote KBStore
+         * @param key The key to put the data under
+         * @param contents The data to put
+         * @param length The length in bytes of the data
+         * @return The version that the remote KBStore gave the value
+         */
+        uint64_t _put(Key& key, const char *contents, size_t length) {
+            // The home node needs the name of the key so that it can be found by prefix
+            const char* name = key.getName();
+            String nameString(name ? name : "");
+
+            // A body that was already sent to the home node is offered by its fingerprint first, since the home node
+            // most likely still has it and the body does not have to be sent again
+            bool fingerprinted = length >= ContentTable::MIN_CONTENT_SIZE;
+            Fingerprint fingerprint;
+            if (fingerprinted) {
+                fingerprint = Fingerprint(contents, length);
+                if (_wasSent(key.getNode(), fingerprint)) {
+                    Serializer offer;
+                    offer.write(&nameString);
+                    offer.write(fingerprint.high);
+                    offer.write(fingerprint.low);
+                    offer.write((uint64_t)length);
+
+                    uint64_t version = _request(key, PUT_IF_CONTENT, offer);
+                    if (version) {
+                        skippedTransfers++;
+                        return version;
+                    }
+                }
+            }
+
+            Serializer serializer;
+            serializer.write(&nameString);
+            serializer._write(contents, length);
+
+            uint64_t version = _request(key, PUT, serializer);
+            if (fingerprinted) { _markSent(key.getNode(), fingerprint); }
+            return version;
+        }
+
+        /**
+         * Determines if this node has put a body on another node
+         * @param node The other node
+         * @param fingerprint The fingerprint of the body
+         */
+        bool _wasSent(size_t node, const Fingerprint& fingerprint) {
+            std::lock_guard<std::mutex> lock(_sentMutex);
+            return _sentContent.count(std::make_pair(node, fingerprint)) != 0;
+        }
+
+        /**
+         * Remembers that this node has put a body on another node. Once too many are remembered they are all forgotten
+         * @param node The other node
+         * @param fingerprint The fingerprint of the body
+         */
+        void _markSent(size_t node, const Fingerprint& fingerprint) {
+            std::lock_guard<std::mutex> lock(_sentMutex);
+            if (_sentContent.size() >= MAX_SENT_CONTENT) { _sentContent.clear(); }
+            _sentContent.insert(std::make_pair(node, fingerprint));
         }
 
         /**
          * Performs a get from a remote client. This can be wait and get or just regular get
          * @param key The key to get
-         * @param type either GET or GET_AND_WAIT
+         * @param type either GET, GET_AND_WAIT or GET_IF_NEWER
          * @return The bytes returned by the remote KBStore
          */
         ByteArray* _get(Key& key, KBMessageType type) {
             Serializer serializer;
-            serializer.write(key);
+            return _get(key, type, serializer);
+        }
 
-            KBMessage message(type, serializer.getBuffer(), serializer.getSize());
+        /**
+         * Performs a get from a remote client
+         * @param key The key to get
+         * @param type either GET, GET_AND_WAIT or GET_IF_NEWER
+         * @param serializer The contents of the request
+         * @return The bytes returned by the remote KBStore
+         */
+        ByteArray* _get(Key& key, KBMessageType type, Serializer& serializer) {
+            KBMessage message(type, serializer.getBuffer(), serializer.getSize(), key.getId());
             RemoteClient* client = _client.send(key.getNode(), message);
 
             Message* m = client->recieve();
@@ -212,13 +1288,19 @@ class KBStore {
             read.deserialize(deserializer);
             assert(read.getKbMessageType() == RESPONSE_DATA);
 
-            if (!read.length()) { return nullptr; }
-            char* buffer = new char[read.length()];
-            memcpy(buffer, read.getData(), read.length() * sizeof(char));
+            ByteArray* bytes = nullptr;
+            if (read.length()) {
+                Deserializer reply(read.length(), read.getData());
+                uint64_t version = reply.read_uint64();
+                size_t length = reply.remainingBytes();
+
+                bytes = new ByteArray(reply.read(length), length);
+                bytes->version = version;
+            }
 
             delete m;
             delete client;
-            return new ByteArray(buffer, read.length());
+            return bytes;
         }
 
         /**
@@ -249,13 +1331,14 @@ class KBStore {
                  * @param connectedClient
                  */
                 virtual void handleMessage(Message *message, RemoteClient &connectedClient) {
+                    // The message outlives the handling of it, so its data does not need to be copied
                     Deserializer deserializer(message->contentSize, message->contents);
                     KBMessage kbMessage;
-                    kbMessage.deserialize(deserializer);
+                    kbMessage.view(deserializer);
 
                     switch (kbMessage.getKbMessageType()) {
                         case PUT:
-                            handlePut(kbMessage, connectedClient);
+                            handlePut(kbMessage, *message, connectedClient);
                             break;
                         case GET:
                             handleGet(kbMessage, connectedClient);
@@ -263,40 +1346,202 @@ class KBStore {
                         case GET_AND_WAIT:
                             handleWaitAndGet(kbMessage, connectedClient);
                             break;
+                        case REMOVE:
+                            handleRemove(kbMessage, connectedClient);
+                            break;
+                        case REMOVE_PREFIX:
+                            handleRemovePrefix(kbMessage, connectedClient);
+                            break;
+                        case EXPIRE:
+                            handleExpire(kbMessage, connectedClient);
+                            break;
+                        case PUT_IF_CONTENT:
+                            handlePutIfContent(kbMessage, connectedClient);
+                            break;
+                        case SCAN:
+                            handleScan(kbMessage, connectedClient);
+                            break;
+                        case PUT_IF_VERSION:
+                            handlePutIfVersion(kbMessage, *message, connectedClient);
+                            break;
+                        case GET_IF_NEWER:
+                            handleGetIfNewer(kbMessage, connectedClient);
+                            break;
+                        case FILTER:
+                            handleExtension(_store._filter, kbMessage, connectedClient);
+                            break;
+                        case DISTRIBUTED_MAP:
+                            handleExtension(_store._mapper, kbMessage, connectedClient);
+                            break;
+                        case GET_DATAFRAME:
+                            handleExtension(_store._dataframeGetter, kbMessage, connectedClient);
+                            break;
                         default:
                             break;
                     }
                 }
 
                 /**
-                 * Handles putting data inside of the store
+                 * Handles putting data inside of the store. The data is stored where it is in the received message
+                 * instead of being copied
                  * @param message The data as well as the key
+                 * @param received The message that was received. Its contents are taken over by the store
+                 * @param connectedClient The connected client
+                 */
+                void handlePut(KBMessage& message, Message& received, RemoteClient &connectedClient) {
+                    Deserializer deserializer(message.length(), message.getData());
+                    Key key(message.getKey(), deserializer.read_string());
+
+                    std::shared_ptr<const char> buffer(received.steal(), std::default_delete<const char[]>());
+                    ByteArray* bytes = new ByteArray(buffer, deserializer.head(), deserializer.remainingBytes());
+
+                    sendAck(_store._putLocal(bytes, key), connectedClient);
+                }
+
+                /**
+                 * Handles putting data inside of the store if the value is at the expected version. The ACK carries
+                 * the version the value was given, or 0 if it was at another version
+                 * @param message The key, the expected version and the data
+                 * @param received The message that was received. Its contents are taken over by the store
+                 * @param connectedClient The connected client
+                 */
+                void handlePutIfVersion(KBMessage& message, Message& received, RemoteClient &connectedClient) {
+                    Deserializer deserializer(message.length(), message.getData());
+                    Key key(message.getKey(), deserializer.read_string());
+                    uint64_t expected = deserializer.read_uint64();
+
+                    std::shared_ptr<const char> buffer(received.steal(), std::default_delete<const char[]>());
+                    ByteArray* bytes = new ByteArray(buffer, deserializer.head(), deserializer.remainingBytes());
+
+                    sendAck(_store._putBody(_store._contents.intern(bytes), key, expected), connectedClient);
+                }
+
+                /**
+                 * Handles getting data out of the store if it changed since a version. If it did not, 0 bytes are
+                 * returned
+                 * @param message The key and the version that was already read
+                 * @param connectedClient The connected client
+                 */
+                void handleGetIfNewer(KBMessage& message, RemoteClient &connectedClient) {
+                    Deserializer deserializer(message.length(), message.getData());
+                    Key key(message.getKey());
+
+                    sendResponse(_store.getIfNewer(key, deserializer.read_uint64()), connectedClient);
+                }
+
+                /**
+                 * Handles putting a value whose body may already be stored on this node. The ACK carries the version
+                 * the value was given, or 0 if the body is not stored here and has to be sent
+                 * @param message The key, the fingerprint of the body and its length
+                 * @param connectedClient The connected client
+                 */
+                void handlePutIfContent(KBMessage& message, RemoteClient &connectedClient) {
+                    Deserializer deserializer(message.length(), message.getData());
+                    Key key(message.getKey(), deserializer.read_string());
+
+                    Fingerprint fingerprint;
+                    fingerprint.high = deserializer.read_uint64();
+                    fingerprint.low = deserializer.read_uint64();
+                    size_t length = deserializer.read_uint64();
+
+                    sendAck(_store._putIfContent(fingerprint, length, key), connectedClient);
+                }
+
+                /**
+                 * Handles removing a value from the store
+                 * @param message The key to remove
+                 * @param connectedClient The connected client
+                 */
+                void handleRemove(KBMessage& message, RemoteClient &connectedClient) {
+                    Key key(message.getKey());
+                    sendAck(_store.remove(key), connectedClient);
+                }
+
+                /**
+                 * Handles removing all of the values on this node under a prefix
+                 * @param message The prefix to remove
+                 * @param connectedClient The connected client
+                 */
+                void handleRemovePrefix(KBMessage& message, RemoteClient &connectedClient) {
+                    Deserializer deserializer(message.length(), message.getData());
+                    String* prefix = deserializer.read_string();
+
+                    sendAck(_store._removeLocalPrefix(prefix->c_str()), connectedClient);
+
+                    delete prefix;
+                }
+
+                /**
+                 * Handles listing the keys on this node under a prefix. The response is the number of keys followed
+                 * by their names
+                 * @param message The prefix to list
                  * @param connectedClient The connected client
                  */
-                void handlePut(KBMessage& message, RemoteClient &connectedClient) {
+                void handleScan(KBMessage& message, RemoteClient &connectedClient) {
                     Deserializer deserializer(message.length(), message.getData());
-                    Key* key = deserializer.read_key();
+                    String* prefix = deserializer.read_string();
+
+                    std::vector<Key*> keys = _store._scanLocal(prefix->c_str());
 
-                    _store.put(deserializer.head(), deserializer.remainingBytes(), *key);
+                    Serializer serializer;
+                    serializer.write((uint64_t)keys.size());
+                    for (Key* key : keys) {
+                        serializer.write(key->getNameAsString());
+                        delete key;
+                    }
 
-                    KBMessage reply(ACK, nullptr, 0);
+                    KBMessage reply(RESPONSE_DATA, serializer.getBuffer(), serializer.getSize());
                     connectedClient.send(reply);
 
-                    delete key;
+                    delete prefix;
                 }
 
                 /**
-                 * Handles getting data out of the store. If the data is not in the store, 0 bytes are returned
-                 * @param message The data as well as the key
+                 * Handles making a value expire
+                 * @param message The key of the value and the time to live in milliseconds
                  * @param connectedClient The connected client
                  */
-                void handleGet(KBMessage& message, RemoteClient &connectedClient) {
+                void handleExpire(KBMessage& message, RemoteClient &connectedClient) {
                     Deserializer deserializer(message.length(), message.getData());
-                    Key* key = deserializer.read_key();
+                    Key key(message.getKey());
+
+                    sendAck(_store.expire(key, deserializer.read_uint64()), connectedClient);
+                }
+
+                /**
+                 * Handles a request that the layer above defines, like a filter or a distributed map
+                 * @param handler The handler of the request
+                 * @param message The request
+                 * @param connectedClient The connected client
+                 */
+                void handleExtension(std::function<void(Deserializer&, Serializer&)>& handler, KBMessage& message,
+                                     RemoteClient &connectedClient) {
+                    Deserializer deserializer(message.length(), message.getData());
+                    Serializer serializer;
+                    handler(deserializer, serializer);
+
+                    KBMessage reply(RESPONSE_DATA, serializer.getBuffer(), serializer.getSize());
+                    connectedClient.send(reply);
+                }
 
-                    sendResponse(_store.get(*key), connectedClient);
+                /**
+                 * Sends an ACK that carries a single number
+                 * @param result The number to send
+                 * @param connectedClient The client to send the ACK to
+                 */
+                void sendAck(uint64_t result, RemoteClient& connectedClient) {
+                    KBMessage reply(ACK, (const char*)&result, sizeof(uint64_t));
+                    connectedClient.send(reply);
+                }
 
-                    delete key;
+                /**
+                 * Handles getting data out of the store. If the data is not in the store, 0 bytes are returned
+                 * @param message The data as well as the key
+                 * @param connectedClient The connected client
+                 */
+                void handleGet(KBMessage& message, RemoteClient &connectedClient) {
+                    Key key(message.getKey());
+                    sendResponse(_store.get(key), connectedClient);
                 }
 
                 /**
@@ -305,17 +1550,13 @@ class KBStore {
                  * @param connectedClient The connected client
                  */
                 void handleWaitAndGet(KBMessage& message, RemoteClient &connectedClient) {
-                    Deserializer deserializer(message.length(), message.getData());
-                    Key* key = deserializer.read_key();
-
-                    sendResponse(_store.waitAndGet(*key), connectedClient);
-
-                    delete key;
+                    Key key(message.getKey());
+                    sendResponse(_store.waitAndGet(key), connectedClient);
                 }
 
                 /**
-                 * Sends the byte array to the given client. If the byte array is empty, a response data with 0 length
-                 * is sent
+                 * Sends the byte array and its version to the given client. If the byte array is empty, a response
+                 * data with 0 length is sent
                  * @param bytes The bytes to send
                  * @param connectedClient The client to send the bytes to
                  */
@@ -324,7 +1565,11 @@ class KBStore {
                         KBMessage reply(RESPONSE_DATA, nullptr, 0);
                         connectedClient.send(reply);
                     } else {
-                        KBMessage reply(RESPONSE_DATA, bytes->contents, bytes->length);
+                        Serializer serializer;
+                        serializer.write(bytes->version);
+                        serializer._write(bytes->contents, bytes->length);
+
+                        KBMessage reply(RESPONSE_DATA, serializer.getBuffer(), serializer.getSize());
                         connectedClient.send(reply);
                         delete bytes;
                     }
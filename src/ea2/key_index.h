@@ -0,0 +1,232 @@
+#pragma once
+
+// Language: C++
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#include "../utils/key.h"
+#include "byte_array.h"
+#include "epoch.h"
+
+/**
+ * A hash index from keys to values that can be read without taking any lock. Writers serialize on a mutex and
+ * publish every change with a single atomic store, so a reader sees either the old or the new state. Memory that
+ * a writer unlinks is freed through the process's Epochs once no reader can still see it.
+ * Readers must be inside of an EpochGuard for as long as they use what they read.
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class KeyIndex {
+    public:
+
+        /** The number of buckets a new index starts with */
+        static const size_t STARTING_BUCKETS = 64;
+
+        /** A key and its value in a bucket's chain */
+        struct Node {
+            /** The key. Owned by the index */
+            Key* key;
+
+            /** The value. Owned by the index */
+            std::atomic<ByteArray*> value;
+
+            /** The next node in the chain */
+            std::atomic<Node*> next;
+
+            Node(Key* key, ByteArray* value, Node* next) : key(key), value(value), next(next) {}
+        };
+
+        /** The buckets of the index. Tables are replaced as a whole when the index grows */
+        struct Table {
+            /** The number of buckets */
+            size_t size;
+
+            /** The head of each bucket's chain */
+            std::atomic<Node*>* buckets;
+
+            Table(size_t size) : size(size), buckets(new std::atomic<Node*>[size]) {
+                for (size_t i = 0; i < size; i++) {
+                    buckets[i] = nullptr;
+                }
+            }
+
+            ~Table() { delete[] buckets; }
+
+            /** Provides the bucket of a key */
+            std::atomic<Node*>& bucketFor(Key& key) { return buckets[key.hash_me() % size]; }
+        };
+
+        /** The current table */
+        std::atomic<Table*> _table;
+
+        /** The number of keys in the index. Only changed by writers */
+        size_t _count = 0;
+
+        /** Mutex that writers hold */
+        std::mutex _writeMutex;
+
+        /** Default constructor */
+        KeyIndex() : _table(new Table(STARTING_BUCKETS)) {}
+
+        ~KeyIndex() {
+            Table* table = _table.load();
+            for (size_t i = 0; i < table->size; i++) {
+                Node* node = table->buckets[i].load();
+                while (node) {
+                    Node* next = node->next.load();
+                    delete node->key;
+                    delete node->value.load();
+                    delete node;
+                    node = next;
+                }
+            }
+
+            delete table;
+        }
+
+        /**
+         * Finds the value of a key without taking a lock. The caller must be inside of an EpochGuard
+         * @param key The key to find
+         * @return The value, or nullptr if there is none. Valid until the caller's EpochGuard ends
+         */
+        ByteArray* get(Key& key) {
+            Node* node = _find(*_table.load(std::memory_order_acquire), key);
+            return node ? node->value.load(std::memory_order_acquire) : nullptr;
+        }
+
+        /**
+         * Stores a value under a key, replacing the value that was there
+         * @param key The key. Cloned if it is not in the index yet
+         * @param value The value. The index takes ownership of it
+         */
+        void put(Key& key, ByteArray* value) {
+            std::lock_guard<std::mutex> lock(_writeMutex);
+
+            Table* table = _table.load();
+            Node* existing = _find(*table, key);
+            if (existing) {
+                ByteArray* old = existing->value.exchange(value, std::memory_order_acq_rel);
+                Epochs::shared().retire([old] { delete old; });
+                return;
+            }
+
+            std::atomic<Node*>& bucket = table->bucketFor(key);
+            bucket.store(new Node((Key*)key.clone(), value, bucket.load()), std::memory_order_release);
+
+            if (++_count > table->size) { _grow(); }
+        }
+
+        /**
+         * Replaces the value of a key only if it has not changed since it was read
+         * @param key The key
+         * @param expected The value that was read
+         * @param value The new value. The index takes ownership of it only if it is stored
+         * @return true if the value was replaced
+         */
+        bool replace(Key& key, ByteArray* expected, ByteArray* value) {
+            std::lock_guard<std::mutex> lock(_writeMutex);
+
+            Node* existing = _find(*_table.load(), key);
+            if (!existing || existing->value.load() != expected) { return false; }
+
+            existing->value.store(value, std::memory_order_release);
+            Epochs::shared().retire([expected] { delete expected; });
+            return true;
+        }
+
+        /**
+         * Removes a key and its value
+         * @param key The key to remove
+         * @return true if the key was in the index
+         */
+        bool remove(Key& key) {
+            std::lock_guard<std::mutex> lock(_writeMutex);
+
+            std::atomic<Node*>* link = &_table.load()->bucketFor(key);
+            for (Node* node = link->load(); node; node = link->load()) {
+                if (node->key->equals(&key)) {
+                    // Readers that are on the node can still follow its next pointer until it is freed
+                    link->store(node->next.load(), std::memory_order_release);
+                    _count--;
+
+                    Epochs::shared().retire([node] {
+                        delete node->key;
+                        delete node->value.load();
+                        delete node;
+                    });
+                    return true;
+                }
+
+                link = &node->next;
+            }
+
+            return false;
+        }
+
+        /**
+         * Calls a function with every key and value in the index without taking a lock. The caller must be inside
+         * of an EpochGuard. Keys that are put or removed during the call may or may not be seen
+         * @param fn The function to call
+         */
+        void forEach(std::function<void(Key*, ByteArray*)> fn) {
+            Table* table = _table.load(std::memory_order_acquire);
+            for (size_t i = 0; i < table->size; i++) {
+                for (Node* node = table->buckets[i].load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire)) {
+                    fn(node->key, node->value.load(std::memory_order_acquire));
+                }
+            }
+        }
+
+        /** Provides the number of keys in the index */
+        size_t size() {
+            std::lock_guard<std::mutex> lock(_writeMutex);
+            return _count;
+        }
+
+        /**
+         * Finds the node of a key in a table
+         * @param table The table to look in
+         * @param key The key to find
+         * @return The node, or nullptr if the key is not in the table
+         */
+        Node* _find(Table& table, Key& key) {
+            for (Node* node = table.bucketFor(key).load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire)) {
+                if (node->key->equals(&key)) { return node; }
+            }
+
+            return nullptr;
+        }
+
+        /**
+         * Publishes a table with twice the buckets. Readers of the old table keep following its chains, so the
+         * nodes are copied instead of moved. The write mutex must be held
+         */
+        void _grow() {
+            Table* old = _table.load();
+            Table* table = new Table(old->size * 2);
+
+            for (size_t i = 0; i < old->size; i++) {
+                for (Node* node = old->buckets[i].load(); node; node = node->next.load()) {
+                    std::atomic<Node*>& bucket = table->bucketFor(*node->key);
+                    bucket.store(new Node(node->key, node->value.load(), bucket.load()));
+                }
+            }
+
+            _table.store(table, std::memory_order_release);
+
+            // The keys and values now belong to the new table's nodes
+            Epochs::shared().retire([old] {
+                for (size_t i = 0; i < old->size; i++) {
+                    Node* node = old->buckets[i].load();
+                    while (node) {
+                        Node* next = node->next.load();
+                        delete node;
+                        node = next;
+                    }
+                }
+
+                delete old;
+            });
+        }
+};
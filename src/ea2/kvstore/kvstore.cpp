@@ -1,10 +1,39 @@
 // Language C++
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <set>
+#include <thread>
+
 #include "kvstore.h"
+#include "../../utils/workers.h"
 #include "../../dataframe/dataframe.h"
 #include "../dataframe_description.h"
+#include "../rebalancer.h"
+
+const size_t KVStore::GATHER_INTERVAL;
+const uint64_t KVStore::REPLACED_CHUNK_TTL;
+
+KVStore::KVStore(in_addr_t ip, uint16_t port, in_addr_t serverIP, uint16_t serverPort): _byteStore(ip, port, serverIP, serverPort),
+                                                                                        _placement(new ConsistentHashPlacement()),
+                                                                                        _generations(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                                                            std::chrono::system_clock::now().time_since_epoch()).count()) {
+    // Filters and distributed maps run over the chunks of dataframes, which the byte store does not know how to read
+    _byteStore.setFilter([this](Deserializer& request, Serializer& reply) { DataFrame::_filterChunk(_byteStore, request, reply); });
+    _byteStore.setMapper([this](Deserializer& request, Serializer& reply) { DataFrame::_mapChunks(*this, request, reply); });
+    _byteStore.setDataframeGetter([this](Deserializer& request, Serializer& reply) { _getWithChunks(request, reply); });
+
+    // The chunks of dataframes that are already stored move to nodes that join the cluster
+    _rebalancer = new Rebalancer(*this);
+    _byteStore.setMembershipListener([this](size_t nodes) { _rebalancer->schedule(); });
+}
 
-KVStore::KVStore(in_addr_t ip, uint16_t port, in_addr_t serverIP, uint16_t serverPort): _byteStore(ip, port, serverIP, serverPort) {}
+KVStore::~KVStore() {
+    _byteStore.setMembershipListener(nullptr);
+    delete _rebalancer;
+    delete _placement;
+}
 
 /**
  * Retrieves the dataframe with the given key from the key value store. If the
@@ -15,6 +44,101 @@ DataFrame* KVStore::get(Key& key) {
     return _dataframeFrom(_byteStore.get(key));
 }
 
+DataFrame* KVStore::get(Key& key, const Prefetch& prefetch) {
+    Serializer request;
+    request.write(key);
+    request.write((uint64_t)prefetch.firstChunks);
+    request.write((uint64_t)prefetch.columns.size());
+    for (size_t column : prefetch.columns) {
+        request.write((uint64_t)column);
+    }
+
+    ByteArray* reply = _byteStore.getDataframe(key.getNode(), request);
+    Deserializer deserializer(reply->length, reply->contents);
+    if (!deserializer.read_uint64()) {
+        delete reply;
+        return nullptr;
+    }
+
+    std::shared_ptr<DataframeDescription> desc = std::make_shared<DataframeDescription>();
+    desc->version = deserializer.read_uint64();
+    desc->deserialize(deserializer);
+    DataFrame* dataframe = _dataframeFrom(desc);
+
+    // The chunks are read straight out of the reply into the columns that they belong to
+    uint64_t chunks = deserializer.read_uint64();
+    for (uint64_t i = 0; i < chunks; i++) {
+        size_t column = deserializer.read_uint64();
+        size_t chunk = deserializer.read_uint64();
+        size_t bytes = deserializer.read_uint64();
+        dynamic_cast<ChunkedColumn*>(dataframe->getColumn(column))->_preload(chunk, deserializer, bytes);
+    }
+
+    delete reply;
+    return dataframe;
+}
+
+void KVStore::_getWithChunks(Deserializer& request, Serializer& reply) {
+    Key* key = request.read_key();
+    size_t firstChunks = request.read_uint64();
+    std::vector<size_t> columns(request.read_uint64());
+    for (size_t& column : columns) {
+        column = request.read_uint64();
+    }
+
+    ByteArray* bytes = _byteStore.get(*key);
+    delete key;
+    if (!bytes) {
+        reply.write((uint64_t)0);
+        return;
+    }
+
+    // The version is sent so that the reader can tell when the description is replaced
+    reply.write((uint64_t)bytes->length);
+    reply.write(bytes->version);
+    reply._write(bytes->contents, bytes->length);
+
+    Deserializer deserializer(bytes->length, bytes->contents);
+    DataframeDescription description;
+    description.deserialize(deserializer);
+    delete bytes;
+
+    // The rows of a small dataframe are already in its description
+    struct Fetched { size_t column; size_t chunk; ByteArray* bytes; };
+    std::vector<Fetched> chunks;
+    size_t node = this_node();
+    for (size_t column = 0; !description.isInline() && column < description.columns(); column++) {
+        bool everyChunk = std::find(columns.begin(), columns.end(), column) != columns.end();
+
+        for (size_t chunk = 0, taken = 0; chunk < description.chunks && (everyChunk || taken < firstChunks); chunk++) {
+            for (size_t copy = 0; copy < description.replication; copy++) {
+                if (description.nodeOf(chunk, copy) != node) { continue; }
+
+                Key* chunkKey = description.keyFor(column, chunk, copy);
+                ByteArray* chunkBytes = _byteStore.get(*chunkKey);
+                delete chunkKey;
+
+                // A chunk that is gone is left for the column to fetch, which fails the way any other read of it does
+                if (chunkBytes) {
+                    chunks.push_back(Fetched{column, chunk, chunkBytes});
+                    taken++;
+                }
+
+                break;
+            }
+        }
+    }
+
+    reply.write((uint64_t)chunks.size());
+    for (Fetched& fetched : chunks) {
+        reply.write((uint64_t)fetched.column);
+        reply.write((uint64_t)fetched.chunk);
+        reply.write((uint64_t)fetched.bytes->length);
+        reply._write(fetched.bytes->contents, fetched.bytes->length);
+        delete fetched.bytes;
+    }
+}
+
 /**
  * Retrieves the dataframe with the given key from the key value store. If the
  * value does not exist, this call will wait until it is available
@@ -30,17 +154,234 @@ DataFrame* KVStore::waitAndGet(Key& key) {
  * @param dataframe The data to store
  * @param key The key of the dataframe in the store
  */
-void KVStore::put(DataFrame* dataframe, Key& key) {
-    size_t stores = _byteStore.nodes();
-    DataframeDescription* description = _descFrom(dataframe, key, stores);
+void KVStore::put(DataFrame* dataframe, Key& key, const PlacementHint& hint) { _put(dataframe, key, KBStore::ANY_VERSION, hint); }
+
+bool KVStore::_put(DataFrame* dataframe, Key& key, uint64_t expected, const PlacementHint& hint) {
+    // A small dataframe is stored inside of its description, so the put is a single operation
+    DataframeDescription* description = _inlineDescFrom(dataframe, key);
+    if (!description) {
+        size_t stores = _byteStore.nodes();
+        size_t chunkRows = Column::chunkRowsFor(dataframe->nrows(), dataframe->get_schema().types(), stores);
+        PlacementPolicy* policy = _policyFor(hint, chunkRows);
+        description = _descFrom(dataframe, key, stores, chunkRows, policy);
+        description->pinned = policy != nullptr;
+        delete policy;
+    }
 
-    for (uint64_t i = 0; i < dataframe->getColumn(0)->numChunks(); i++) {
-        putDataframeChunk(key, dataframe, i, stores);
+    size_t copies = description->replication;
+    size_t chunkRows = description->chunkRows;
+    size_t chunks = description->isInline() ? 0 : description->chunks;
+
+    // Chunks are uploaded to their home nodes in parallel, a bounded number at a time
+    {
+        Workers uploads(UPLOAD_WINDOW);
+        for (uint64_t i = 0; i < chunks; i++) {
+            uploads.submit([this, &key, dataframe, description, copies, chunkRows, i] {
+                std::vector<size_t> nodes(copies);
+                for (size_t copy = 0; copy < copies; copy++) {
+                    nodes[copy] = description->nodeOf(i, copy);
+                }
+
+                putDataframeChunk(key, description->generationOf(0), dataframe, i, nodes.data(), copies, chunkRows);
+            });
+        }
     }
 
-    putDataframeDesc(key, description);
+    bool published = true;
+    if (expected == KBStore::ANY_VERSION) {
+        putDataframeDesc(key, description);
+    } else {
+        // The description that is replaced is read first, so that its chunks can be expired once nothing refers to them
+        ByteArray* replaced = _byteStore.get(key);
+        if (replaced && replaced->version != expected) {
+            delete replaced;
+            replaced = nullptr;
+        }
+
+        Serializer serializer;
+        description->serialize(serializer);
+        published = _byteStore.putIfVersion(serializer.getBuffer(), serializer.getSize(), key, expected) != 0;
+
+        // The chunks of a description that was not published are never read
+        for (size_t col = 0; !published && col < description->columns(); col++) {
+            for (size_t chunk = 0; chunk < chunks; chunk++) {
+                for (size_t copy = 0; copy < copies; copy++) {
+                    Key* chunkKey = description->keyFor(col, chunk, copy);
+                    _byteStore.remove(*chunkKey);
+                    delete chunkKey;
+                }
+            }
+        }
+
+        if (published) {
+            _expireReplaced(replaced);
+        } else {
+            delete replaced;
+        }
+    }
 
     delete description;
+    return published;
+}
+
+void KVStore::append(Key& key, DataFrame* rows) {
+    if (!rows->nrows()) { return; }
+
+    while (!_tryAppend(key, rows)) {}
+}
+
+bool KVStore::_tryAppend(Key& key, DataFrame* rows) {
+    // With no dataframe yet the rows are put only if nothing else was put first, so that racing appends retry
+    ByteArray* bytes = _byteStore.get(key);
+    if (!bytes) { return _put(rows, key, 0); }
+
+    uint64_t version = bytes->version;
+    Deserializer deserializer(bytes->length, bytes->contents);
+    std::shared_ptr<DataframeDescription> old = std::make_shared<DataframeDescription>();
+    old->deserialize(deserializer);
+    delete bytes;
+
+    assert(!strcmp(old->schema->c_str(), rows->get_schema().types()));
+
+    // The rows of a small dataframe are all in its description, so it is put again with the new rows
+    if (old->isInline()) {
+        Schema schema(old->schema->c_str());
+        DataFrame combined(schema);
+        DataFrame* existing = _dataframeFrom(old);
+        combined.add_rows(existing, 0, old->rows);
+        combined.add_rows(rows, 0, rows->nrows());
+        delete existing;
+
+        return _put(&combined, key, version);
+    }
+
+    // The rows of the partial last chunk are written again with the new rows, since chunks are never overwritten
+    size_t tail = old->chunks ? old->rows - (old->chunks - 1) * old->chunkRows : 0;
+    if (tail == old->chunkRows) { tail = 0; }
+
+    Schema schema(old->schema->c_str());
+    DataFrame added(schema);
+    if (tail) {
+        DataFrame* existing = _dataframeFrom(old);
+        added.add_rows(existing, old->rows - tail, old->rows);
+        delete existing;
+    }
+
+    added.add_rows(rows, 0, rows->nrows());
+
+    DataframeDescription* desc = dynamic_cast<DataframeDescription*>(old->clone());
+    if (tail) { desc->removeLastChunk(); }
+
+    uint64_t generation = _newGeneration();
+    desc->addSegment(generation);
+    desc->rows = old->rows + rows->nrows();
+
+    size_t stores = _byteStore.nodes();
+    size_t copies = desc->replication;
+    size_t first = desc->chunks;
+    size_t chunks = added.getColumn(0)->numChunks(desc->chunkRows);
+    std::vector<size_t> nodes(copies);
+    std::vector<ZoneMap> zoneMaps(desc->columns());
+    for (size_t chunk = first; chunk < first + chunks; chunk++) {
+        _homesFor(key, chunk, stores, copies, nodes.data());
+        for (size_t col = 0; col < desc->columns(); col++) {
+            zoneMaps[col] = added.getColumn(col)->zoneMapOf(chunk - first, desc->chunkRows);
+        }
+
+        desc->addChunk(nodes.data(), zoneMaps.data());
+    }
+
+    {
+        Workers uploads(UPLOAD_WINDOW);
+        for (size_t i = 0; i < chunks; i++) {
+            uploads.submit([this, &key, &added, desc, generation, first, copies, i] {
+                std::vector<size_t> chunkNodes(copies);
+                for (size_t copy = 0; copy < copies; copy++) {
+                    chunkNodes[copy] = desc->nodeOf(first + i, copy);
+                }
+
+                putDataframeChunk(key, generation, &added, first + i, chunkNodes.data(), copies, desc->chunkRows, i);
+            });
+        }
+    }
+
+    Serializer serializer;
+    desc->serialize(serializer);
+    bool published = _byteStore.putIfVersion(serializer.getBuffer(), serializer.getSize(), key, version) != 0;
+
+    // The chunks that were written for a description that lost the race are never read
+    for (size_t col = 0; col < desc->columns(); col++) {
+        for (size_t copy = 0; copy < copies; copy++) {
+            for (size_t chunk = first; !published && chunk < first + chunks; chunk++) {
+                Key* chunkKey = desc->keyFor(col, chunk, copy);
+                _byteStore.remove(*chunkKey);
+                delete chunkKey;
+            }
+
+            if (published && tail) {
+                Key* chunkKey = old->keyFor(col, old->chunks - 1, copy);
+                _byteStore.expire(*chunkKey, REPLACED_CHUNK_TTL);
+                delete chunkKey;
+            }
+        }
+    }
+
+    delete desc;
+    return published;
+}
+
+bool KVStore::remove(Key& key) {
+    ByteArray* desc = _byteStore.get(key);
+    if (!desc) { return false; }
+
+    // Remove the description first so that no new readers find chunks that are about to be removed
+    _byteStore.remove(key);
+    _forEachChunk(desc, [&](Key& chunkKey) { _byteStore.remove(chunkKey); });
+    return true;
+}
+
+bool KVStore::expire(Key& key, uint64_t ttl) {
+    ByteArray* desc = _byteStore.get(key);
+    if (!desc) { return false; }
+
+    _byteStore.expire(key, ttl);
+    _forEachChunk(desc, [&](Key& chunkKey) { _byteStore.expire(chunkKey, ttl); });
+    return true;
+}
+
+size_t KVStore::removePrefix(const char* prefix) { return _byteStore.removePrefix(prefix); }
+
+std::vector<Key*> KVStore::scan(const char* prefix) { return _byteStore.scan(prefix); }
+
+void KVStore::gather(const char* prefix, size_t count, std::function<void(Key&, DataFrame*)> fn) {
+    std::set<KeyId> seen;
+    while (seen.size() < count) {
+        std::vector<Key*> found;
+        for (Key* key : scan(prefix)) {
+            if (seen.insert(key->getId()).second) {
+                found.push_back(key);
+            } else {
+                delete key;
+            }
+        }
+
+        if (found.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(GATHER_INTERVAL));
+            continue;
+        }
+
+        std::vector<DataFrame*> dataframes(found.size());
+        std::vector<std::thread> fetches;
+        for (size_t i = 0; i < found.size(); i++) {
+            fetches.emplace_back([this, &found, &dataframes, i] { dataframes[i] = waitAndGet(*found[i]); });
+        }
+
+        for (size_t i = 0; i < found.size(); i++) {
+            fetches[i].join();
+            fn(*found[i], dataframes[i]);
+            delete found[i];
+        }
+    }
 }
 
 /**
@@ -49,67 +390,167 @@ void KVStore::put(DataFrame* dataframe, Key& key) {
  */
 size_t KVStore::this_node() const { return _byteStore.this_node(); }
 
-/** Generates a description of a dataframe that can be serialized */
-DataframeDescription* KVStore::_descFrom(DataFrame* dataframe, Key& key, size_t stores) {
-    // Generate column descriptions
-    size_t columns = dataframe->ncols();
-    ColumnDescription** descriptions = new ColumnDescription*[columns];
+void KVStore::setPlacement(PlacementPolicy* placement) {
+    delete _placement;
+    _placement = placement;
+}
+
+void KVStore::setReplication(size_t replication) { _replication = replication ? replication : 1; }
+
+size_t KVStore::_copies(size_t nodes) const { return std::min(_replication, nodes); }
+
+size_t KVStore::_homeFor(const Key& key, size_t chunk, size_t nodes) { return _placement->nodeFor(key, chunk, nodes); }
+
+void KVStore::_homesFor(const Key& key, size_t chunk, size_t nodes, size_t copies, size_t* out, PlacementPolicy* policy) {
+    (policy ? policy : _placement)->nodesFor(key, chunk, nodes, copies, out);
+}
+
+PlacementPolicy* KVStore::_policyFor(const PlacementHint& hint, size_t chunkRows) {
+    if (hint.kind == PlacementHint::LOCAL) { return new LocalPlacement(this_node()); }
+    if (hint.kind != PlacementHint::COLOCATED) { return nullptr; }
+
+    // A dataframe that is not stored has nowhere to be homed with
+    ByteArray* bytes = _byteStore.get(*hint.with);
+    if (!bytes) { return nullptr; }
+
+    Deserializer deserializer(bytes->length, bytes->contents);
+    DataframeDescription with;
+    with.deserialize(deserializer);
+    delete bytes;
+
+    std::vector<size_t> homes(with.chunks);
+    for (size_t chunk = 0; chunk < with.chunks; chunk++) {
+        homes[chunk] = with.nodeOf(chunk, 0);
+    }
+
+    return new ColocatedPlacement(homes, with.chunkRows, chunkRows);
+}
 
-    for (size_t i = 0; i < columns; i++) {
-        Column* column = dataframe->getColumn(i);
-        size_t numChunks = column->numChunks();
-        Key** chunkKeys = new Key*[numChunks];
+/** Generates a description of a dataframe that can be serialized. This is where the chunks are placed and summarized */
+DataframeDescription* KVStore::_descFrom(DataFrame* dataframe, Key& key, size_t stores, size_t chunkRows, PlacementPolicy* policy) {
+    size_t copies = _copies(stores);
+    DataframeDescription* description = new DataframeDescription(new String(dataframe->get_schema().types()), new String(key.getName()),
+                                                                  _newGeneration(), dataframe->nrows(), chunkRows, copies);
+    description->keyNode = (uint8_t)key.getNode();
 
-        for (size_t chunk = 0; chunk < numChunks; chunk++) {
-            chunkKeys[chunk] = _keyFor(key, i, chunk, stores);
+    std::vector<size_t> nodes(copies);
+    std::vector<ZoneMap> zoneMaps(dataframe->ncols());
+    size_t chunks = dataframe->ncols() ? dataframe->getColumn(0)->numChunks(chunkRows) : 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        _homesFor(key, chunk, stores, copies, nodes.data(), policy);
+        for (size_t col = 0; col < dataframe->ncols(); col++) {
+            zoneMaps[col] = dataframe->getColumn(col)->zoneMapOf(chunk, chunkRows);
         }
 
-        descriptions[i] = new ColumnDescription(chunkKeys, numChunks, column->size(), (ColumnType)dataframe->get_schema().col_type(i));
+        description->addChunk(nodes.data(), zoneMaps.data());
     }
 
-    return new DataframeDescription(new String(dataframe->get_schema().types()), columns, descriptions);
+    return description;
 }
 
-Key* KVStore::_keyFor(const Key& key, size_t column, size_t chunk, size_t nodes) {
-    sprintf(_keyBuffer, "%s-%zu-%zu", key.getName(), column, chunk);
-    return new Key(_keyBuffer, chunk % nodes);
+DataframeDescription* KVStore::_inlineDescFrom(DataFrame* dataframe, Key& key) {
+    // Only dataframes that are small to begin with are serialized to find out if they fit
+    size_t rows = dataframe->ncols() ? dataframe->nrows() : 0;
+    if (!dataframe->ncols() || rows * dataframe->ncols() * sizeof(Element) > INLINE_BYTES) { return nullptr; }
+
+    size_t chunkRows = rows ? rows : 1;
+    Serializer serializer;
+    for (size_t col = 0; col < dataframe->ncols(); col++) {
+        dataframe->getColumn(col)->serializeChunk(serializer, 0, chunkRows);
+    }
+
+    if (serializer.getSize() > INLINE_BYTES) { return nullptr; }
+
+    // The only chunk is homed where the description is, so that a single node visits it in a local map
+    DataframeDescription* description = new DataframeDescription(new String(dataframe->get_schema().types()), new String(key.getName()),
+                                                                  _newGeneration(), rows, chunkRows, 1);
+    description->keyNode = (uint8_t)key.getNode();
+    description->inlined.assign(serializer.getBuffer(), serializer.getBuffer() + serializer.getSize());
+
+    size_t home = key.getNode();
+    std::vector<ZoneMap> zoneMaps(dataframe->ncols());
+    for (size_t col = 0; col < dataframe->ncols(); col++) {
+        zoneMaps[col] = dataframe->getColumn(col)->zoneMapOf(0, chunkRows);
+    }
+
+    description->addChunk(&home, zoneMaps.data());
+    return description;
+}
+
+uint64_t KVStore::_newGeneration() {
+    const uint64_t NODE_SHIFT = 56;
+    return ((uint64_t)this_node() << NODE_SHIFT) | (++_generations & ((1ULL << NODE_SHIFT) - 1));
+}
+
+void KVStore::_forEachChunk(ByteArray* desc, std::function<void(Key&)> fn) {
+    Deserializer deserializer(desc->length, desc->contents);
+    DataframeDescription description;
+    description.deserialize(deserializer);
+
+    // The rows of a small dataframe are in its description, so it has no chunks stored under their own keys
+    for (size_t column = 0; !description.isInline() && column < description.columns(); column++) {
+        for (size_t chunk = 0; chunk < description.chunks; chunk++) {
+            for (size_t copy = 0; copy < description.replication; copy++) {
+                Key* chunkKey = description.keyFor(column, chunk, copy);
+                fn(*chunkKey);
+                delete chunkKey;
+            }
+        }
+    }
+
+    delete desc;
 }
 
 DataFrame *KVStore::_dataframeFrom(ByteArray* bytes) {
     if (!bytes) { return nullptr; }
 
     Deserializer deserializer(bytes->length, bytes->contents);
-    DataframeDescription desc;
-    desc.deserialize(deserializer);
+    std::shared_ptr<DataframeDescription> desc = std::make_shared<DataframeDescription>();
+    desc->deserialize(deserializer);
+    desc->version = bytes->version;
+    delete bytes;
+
+    return _dataframeFrom(desc);
+}
 
+DataFrame* KVStore::_dataframeFrom(std::shared_ptr<DataframeDescription> desc) {
     Schema schema("");
     DataFrame* dataframe = new DataFrame(schema);
 
-    for (size_t i = 0; i < desc.numColumns; i++) {
-        ColumnDescription* colDesc = desc.columns[i];
-        Key** keyCopies = new Key*[colDesc->chunks];
-        for (size_t chunk = 0; chunk < colDesc->chunks; chunk++) {
-            keyCopies[chunk] = (Key*)colDesc->keys[chunk]->clone();
-        }
-
-        Column* newColumn = allocateChunkedColumnOfType(colDesc->type, keyCopies, colDesc->chunks, _byteStore, colDesc->totalLength);
-        dataframe->add_column(newColumn, nullptr);
+    // The columns share the description and derive the keys of their chunks from it when they are read
+    for (size_t i = 0; i < desc->columns(); i++) {
+        dataframe->add_column(allocateChunkedColumnOfType(desc->typeOf(i), desc, i, _byteStore), nullptr);
     }
 
-    delete bytes;
     return dataframe;
 }
 
-void KVStore::putDataframeChunk(const Key& key, DataFrame* dataframe, size_t chunk, size_t nodes, long int serializedChunk) {
+void KVStore::putDataframeChunk(const Key& key, uint64_t generation, DataFrame* dataframe, size_t chunk, const size_t* nodes,
+                                size_t copies, size_t chunkRows, long int serializedChunk) {
     for (size_t col = 0; col < dataframe->ncols(); col++) {
         Column* column = dataframe->getColumn(col);
 
-        Key* chunkKey = _keyFor(key, col, chunk, nodes);
         Serializer serializer;
-        column->serializeChunk(serializer, serializedChunk == -1 ? chunk : serializedChunk);
+        column->serializeChunk(serializer, serializedChunk == -1 ? chunk : serializedChunk, chunkRows);
+
+        // The copy on this node takes over the serializer's buffer, so it is put after the copies on other nodes
+        size_t local = copies;
+        for (size_t copy = 0; copy < copies; copy++) {
+            if (nodes[copy] == this_node()) {
+                local = copy;
+                continue;
+            }
+
+            Key* chunkKey = DataframeDescription::chunkKey(key.getName(), generation, col, chunk, nodes[copy]);
+            _byteStore.put(serializer.getBuffer(), serializer.getSize(), *chunkKey);
+            delete chunkKey;
+        }
 
-        _byteStore.put(serializer.getBuffer(), serializer.getSize(), *chunkKey);
-        delete chunkKey;
+        if (local != copies) {
+            Key* chunkKey = DataframeDescription::chunkKey(key.getName(), generation, col, chunk, nodes[local]);
+            _byteStore.put(serializer, *chunkKey);
+            delete chunkKey;
+        }
     }
 }
 
@@ -117,5 +558,14 @@ void KVStore::putDataframeDesc(Key &key, DataframeDescription *desc) {
     Serializer serializer;
     desc->serialize(serializer);
 
-    _byteStore.put(serializer.getBuffer(), serializer.getSize(), key);
+    ByteArray* replaced = _byteStore.get(key);
+    _byteStore.put(serializer, key);
+    _expireReplaced(replaced);
+}
+
+void KVStore::_expireReplaced(ByteArray* replaced) {
+    if (!replaced) { return; }
+
+    // Readers that still hold the replaced description can finish reading its chunks before they expire
+    _forEachChunk(replaced, [&](Key& chunkKey) { _byteStore.expire(chunkKey, REPLACED_CHUNK_TTL); });
 }
@@ -3,12 +3,16 @@
 // Language: C++
 
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "../../utils/instructor-provided/object.h"
 #include "../../utils/instructor-provided/string.h"
 #include "../../utils/datastructures/map.h"
 #include "../../utils/key.h"
 #include "../kbstore.h"
+#include "../placement.h"
 
 /**
  * The distributed key value store. This will connect to the central rendezvous server
@@ -21,6 +25,62 @@ public:
     /** The store for raw bytes under keys */
     KBStore _byteStore;
 
+    /** Decides which node each chunk of a new dataframe is homed on. Owned by the store */
+    PlacementPolicy* _placement;
+
+    /** The number of copies that are stored of each chunk of a new dataframe */
+    size_t _replication = 1;
+
+    /** Moves the chunks of the dataframes stored on this node when nodes join the cluster. Owned by the store */
+    class Rebalancer* _rebalancer;
+
+    /** The maximum number of chunks that put uploads at the same time */
+    static const size_t UPLOAD_WINDOW = 8;
+
+    /**
+     * The number of chunks that are uploaded at the same time while a dataframe is being built. Kept small since every
+     * chunk that is waiting to be uploaded is held in memory
+     */
+    static const size_t INGEST_WINDOW = 2;
+
+    /** How long gather waits before listing the keys under its prefix again, in milliseconds */
+    static const size_t GATHER_INTERVAL = 5;
+
+    /**
+     * How long the partial last chunk that an append replaced is kept for readers that still hold the old description,
+     * in milliseconds
+     */
+    static const uint64_t REPLACED_CHUNK_TTL = 60000;
+
+    /**
+     * The most bytes the rows of a dataframe take up for them to be stored inside of its description, so that the
+     * dataframe is put and read in a single operation
+     */
+    static const size_t INLINE_BYTES = 4096;
+
+    /**
+     * Which chunks a get fetches in the same round trip as the description of a dataframe. Only chunks with a copy on
+     * the node the description is stored on can be fetched this way, since that node replies to the get
+     */
+    struct Prefetch {
+        /** The number of chunks of every column to fetch, starting from the first one that has a copy on the node */
+        size_t firstChunks;
+
+        /** The columns to fetch every chunk of that has a copy on the node */
+        std::vector<size_t> columns;
+
+        /**
+         * Default constructor
+         * @param firstChunks The number of chunks of every column to fetch
+         * @param columns The columns to fetch every chunk of
+         */
+        Prefetch(size_t firstChunks = 0, std::vector<size_t> columns = std::vector<size_t>()) :
+            firstChunks(firstChunks), columns(columns) {}
+    };
+
+    /** The number of generations this store has handed out. Starts at the time the store was created */
+    std::atomic<uint64_t> _generations;
+
     /**
      * Default constructor
      * @param ip The IP that the client is reachable at
@@ -30,6 +90,8 @@ public:
      */
     KVStore(in_addr_t ip, uint16_t port, in_addr_t serverIP, uint16_t serverPort);
 
+    ~KVStore();
+
     /**
      * Retrieves the dataframe with the given key from the key value store. If the
      * value does not exist, nullptr is returned
@@ -37,6 +99,14 @@ public:
      */
     class DataFrame* get(Key& key);
 
+    /**
+     * Retrieves the dataframe with the given key along with some of its chunks, in a single round trip to the node
+     * the dataframe is stored on. If the value does not exist, nullptr is returned
+     * @param key The key of the dataframe to return
+     * @param prefetch The chunks to fetch along with the description
+     */
+    class DataFrame* get(Key& key, const Prefetch& prefetch);
+
     /**
      * Retrieves the dataframe with the given key from the key value store. If the
      * value does not exist, this call will wait until it is available
@@ -49,8 +119,70 @@ public:
      * this machine, it is sent across the network.
      * @param dataframe The data to store
      * @param key The key of the dataframe in the store
+     * @param hint Optional. Where to home the chunks instead of where the placement policy puts them. Small
+     *             dataframes are stored inside of their description, so the hint does not apply to them
+     */
+    void put(class DataFrame* dataframe, Key& key, const PlacementHint& hint = PlacementHint());
+
+    /**
+     * Adds rows to the end of a stored dataframe. Only the partial last chunk and the new chunks are written, and the
+     * new description is published with a single conditional put, so readers see either all of the new rows or none
+     * of them. Readers that hold the old description keep working. Appends that race each other are retried
+     * @param key The key of the dataframe. If there is no dataframe under it, the rows are put as a new dataframe
+     * @param rows The rows to add. Must have the same schema as the dataframe. Not owned
+     */
+    void append(Key& key, class DataFrame* rows);
+
+    /**
+     * Puts a dataframe in the store, only publishing its description if the value under the key is at a version
+     * @param dataframe The data to store
+     * @param key The key of the dataframe in the store
+     * @param expected The version the value must be at. KBStore::ANY_VERSION to publish it whatever is there
+     * @param hint Optional. Where to home the chunks
+     * @return false if the value was at another version, in which case nothing was stored
+     */
+    bool _put(class DataFrame* dataframe, Key& key, uint64_t expected, const PlacementHint& hint = PlacementHint());
+
+    /**
+     * Removes the dataframe with the given key and all of its chunks from the store
+     * @param key The key of the dataframe to remove
+     * @return true if there was a dataframe to remove
+     */
+    bool remove(Key& key);
+
+    /**
+     * Makes the dataframe with the given key and all of its chunks expire after some time
+     * @param key The key of the dataframe
+     * @param ttl The number of milliseconds from now that the dataframe expires
+     * @return true if there was a dataframe to expire
+     */
+    bool expire(Key& key, uint64_t ttl);
+
+    /**
+     * Removes every value whose key starts with the given prefix from the whole cluster. Since the keys of chunks
+     * start with the key of their dataframe, this removes whole dataframes
+     * @param prefix The prefix of the keys to remove
+     * @return The number of values that were removed, including chunks
+     */
+    size_t removePrefix(const char* prefix);
+
+    /**
+     * Lists the keys of the dataframes in the whole cluster whose keys start with the given prefix
+     * @param prefix The prefix of the keys to list
+     * @return The keys with their names and home nodes. The caller owns them
+     */
+    std::vector<Key*> scan(const char* prefix);
+
+    /**
+     * Waits for dataframes under a prefix to be stored and hands each to a function once it is found. Dataframes
+     * that are found together are fetched at the same time, and dataframes that are not stored yet do not hold up
+     * the ones that are
+     * @param prefix The prefix of the keys of the dataframes
+     * @param count The number of dataframes to wait for
+     * @param fn Called with the key and the dataframe from the calling thread, one dataframe at a time. Owns the
+     *           dataframe
      */
-    void put(class DataFrame* dataframe, Key& key);
+    void gather(const char* prefix, size_t count, std::function<void(Key&, class DataFrame*)> fn);
 
     /**
      * Provides the node identifier of the running application. This is determined
@@ -58,23 +190,100 @@ public:
      */
     size_t this_node() const;
 
+    /**
+     * Changes how chunks of dataframes that are put from now on are placed. Dataframes that are already stored
+     * keep their placement since it is recorded in their descriptions, until nodes join the cluster and the
+     * dataframes whose descriptions are on this node are placed again with the new policy
+     * @param placement The new placement policy. The store takes ownership of it
+     */
+    void setPlacement(PlacementPolicy* placement);
+
+    /**
+     * Changes how many copies are stored of each chunk of dataframes that are put from now on. Copies are stored
+     * on distinct nodes, so readers can spread out over them and fall back on another copy when a node is slow
+     * @param replication The number of copies of each chunk. At least 1
+     */
+    void setReplication(size_t replication);
+
+    /**
+     * Provides the number of copies that are stored of each chunk of a new dataframe
+     * @param nodes The number of nodes in the cluster
+     */
+    size_t _copies(size_t nodes) const;
+
+    /**
+     * Provides the home node of a chunk of a dataframe according to the placement policy
+     * @param key The key the dataframe is stored under
+     * @param chunk The index of the chunk
+     * @param nodes The number of nodes in the cluster
+     */
+    size_t _homeFor(const Key& key, size_t chunk, size_t nodes);
+
+    /**
+     * Provides the nodes of the copies of a chunk of a dataframe according to the placement policy
+     * @param key The key the dataframe is stored under
+     * @param chunk The index of the chunk
+     * @param nodes The number of nodes in the cluster
+     * @param copies The number of copies
+     * @param out Filled with the node of every copy, starting with the home node
+     * @param policy Optional. The policy to use instead of the store's placement policy
+     */
+    void _homesFor(const Key& key, size_t chunk, size_t nodes, size_t copies, size_t* out, PlacementPolicy* policy = nullptr);
+
+    /**
+     * Provides the placement policy that carries out a placement hint
+     * @param hint The hint
+     * @param chunkRows The number of rows in every chunk but the last of the dataframe being placed
+     * @return The policy, or nullptr if the store's placement policy should be used. The caller owns it
+     */
+    PlacementPolicy* _policyFor(const PlacementHint& hint, size_t chunkRows);
+
     /**
      * Generates a description of the dataframe in the distributed key store.
      * @param dataframe The dataframe to generate the description of
      * @param key The key the dataframe will be stored under
      * @param stores The number of stores
+     * @param chunkRows The number of rows in every chunk but the last
+     * @param policy Optional. The policy to place the chunks with instead of the store's placement policy
      */
-    class DataframeDescription* _descFrom(class DataFrame* dataframe, Key& key, size_t stores);
+    class DataframeDescription* _descFrom(class DataFrame* dataframe, Key& key, size_t stores, size_t chunkRows,
+                                          PlacementPolicy* policy = nullptr);
 
     /**
-     * Provides the key for the column in the byte stores
-     * @param key The key that the dataframe is stored under
-     * @param column The column index
-     * @param chunk The chunk index
-     * @param node The node for the key
-     * @return The key for the column in a dataframe stored under the given key
+     * Generates a description of a dataframe that holds its rows, if the dataframe is small enough
+     * @param dataframe The dataframe to generate the description of
+     * @param key The key the dataframe will be stored under
+     * @return The description, or nullptr if the rows take up more than INLINE_BYTES
+     */
+    class DataframeDescription* _inlineDescFrom(class DataFrame* dataframe, Key& key);
+
+    /**
+     * Provides a generation for the chunks of a dataframe that is about to be put. Generations are unique across the
+     * cluster, since the node is in the top bits, so a dataframe that is put again never reuses a chunk key
+     */
+    uint64_t _newGeneration();
+
+    /**
+     * Calls a function with the key of every chunk in a serialized dataframe description
+     * @param desc The serialized description. This is deleted
+     * @param fn The function to call with every copy of every chunk of every column
+     */
+    void _forEachChunk(ByteArray* desc, std::function<void(Key&)> fn);
+
+    /**
+     * Expires the chunks of a description that was replaced, after long enough for its readers to finish
+     * @param replaced The serialized description that was replaced, or nullptr if there was none. This is deleted
      */
-    Key* _keyFor(const Key& key, size_t column, size_t chunk, size_t node);
+    void _expireReplaced(ByteArray* replaced);
+
+    /**
+     * Replies to a get of a dataframe along with its chunks on the node the dataframe is stored on. The reply is the
+     * length of the description, 0 if there is none, the version and the bytes of the description, the number of
+     * chunks and then the column, index, length and bytes of every chunk
+     * @param request The key of the dataframe followed by what Prefetch holds
+     * @param reply The reply
+     */
+    void _getWithChunks(Deserializer& request, Serializer& reply);
 
     /**
      * Creates a new dataframe using the dataframe description
@@ -84,15 +293,34 @@ public:
     DataFrame* _dataframeFrom(ByteArray* desc);
 
     /**
-     * Puts a single chunk from all of the columns in the data store
+     * Creates a new dataframe whose columns read their chunks through a description
+     * @param desc The description of the dataframe. Shared by the columns
+     * @return A new dataframe
+     */
+    DataFrame* _dataframeFrom(std::shared_ptr<DataframeDescription> desc);
+
+    /**
+     * Appends rows to a stored dataframe once
+     * @param key The key of the dataframe
+     * @param rows The rows to add
+     * @return false if another write published a description first, in which case nothing was changed
+     */
+    bool _tryAppend(Key& key, class DataFrame* rows);
+
+    /**
+     * Puts every copy of a single chunk from all of the columns in the data store
      * @param key The key to use for the datafame
+     * @param generation The generation of the dataframe's chunks
      * @param dataframe The dataframe to put chunks of
      * @param chunk The chunk index to put into the store
-     * @param nodes The number of nodes that are connected
+     * @param nodes The node to store each copy on
+     * @param copies The number of copies
+     * @param chunkRows The number of rows in every chunk but the last
      * @param serializedChunk Optional. If this is set, the actual contents of what gets put will be the chunk
      *                        at that index
      */
-    void putDataframeChunk(const Key& key, DataFrame* dataframe, size_t chunk, size_t nodes, long int serializedChunk = -1);
+    void putDataframeChunk(const Key& key, uint64_t generation, DataFrame* dataframe, size_t chunk, const size_t* nodes,
+                           size_t copies, size_t chunkRows, long int serializedChunk = -1);
 
     /**
      * Puts the dataframe description into the store
@@ -101,7 +329,4 @@ public:
      */
     void putDataframeDesc(Key& key, DataframeDescription* desc);
 
-    /** Names up until 1024 including the column numbers are supported. No actual checking is done */
-    char _keyBuffer[1024];
-
 };
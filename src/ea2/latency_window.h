@@ -0,0 +1,61 @@
+#pragma once
+
+// Language: C++
+
+#include <algorithm>
+#include <mutex>
+
+/**
+ * Keeps the most recent request latencies so that percentiles of them can be computed. Used to decide when a
+ * request has taken long enough that a hedged request should be sent to another replica
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class LatencyWindow {
+    public:
+
+        /** The number of latencies that are kept */
+        static const size_t WINDOW = 128;
+
+        /** The number of latencies needed before percentiles are reported */
+        static const size_t MIN_SAMPLES = 16;
+
+        /** The most recent latencies in microseconds, as a ring buffer */
+        uint64_t _samples[WINDOW];
+
+        /** The number of latencies in the window */
+        size_t _count = 0;
+
+        /** The index the next latency is written to */
+        size_t _next = 0;
+
+        /** Mutex for the samples */
+        std::mutex _mutex;
+
+        /**
+         * Records the latency of a request
+         * @param micros The latency in microseconds
+         */
+        void record(uint64_t micros) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _samples[_next] = micros;
+            _next = (_next + 1) % WINDOW;
+            if (_count < WINDOW) { _count++; }
+        }
+
+        /**
+         * Provides a percentile of the recent latencies
+         * @param percentile The percentile to compute, between 0 and 1
+         * @return The latency in microseconds, or 0 if there are not enough latencies yet
+         */
+        uint64_t percentile(double percentile) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_count < MIN_SAMPLES) { return 0; }
+
+            uint64_t sorted[WINDOW];
+            std::copy(_samples, _samples + _count, sorted);
+
+            size_t rank = std::min((size_t)(percentile * _count), _count - 1);
+            std::nth_element(sorted, sorted + rank, sorted + _count);
+            return sorted[rank];
+        }
+};
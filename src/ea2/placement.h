@@ -0,0 +1,230 @@
+#pragma once
+
+// Language: C++
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "../utils/instructor-provided/string.h"
+#include "../utils/key.h"
+
+/**
+ * Scrambles the bits of a 64 bit value (the splitmix64 finalizer)
+ * @param value The value to scramble
+ * @return The scrambled value
+ */
+inline uint64_t mix64(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+/**
+ * Decides which node is the home of each chunk of a dataframe. All of the columns of a chunk are always
+ * homed on the same node so that a row can be read from a single node.
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class PlacementPolicy {
+    public:
+
+        virtual ~PlacementPolicy() {}
+
+        /**
+         * Provides the home node of a chunk
+         * @param key The key the dataframe is stored under
+         * @param chunk The index of the chunk
+         * @param nodes The number of nodes in the cluster
+         * @return The node the chunk should be stored on
+         */
+        virtual size_t nodeFor(const Key& key, size_t chunk, size_t nodes) = 0;
+
+        /**
+         * Provides the nodes that hold the copies of a replicated chunk. The first node is the home node and the
+         * rest are the nodes that follow it
+         * @param key The key the dataframe is stored under
+         * @param chunk The index of the chunk
+         * @param nodes The number of nodes in the cluster
+         * @param copies The number of copies of the chunk. Must not be more than the number of nodes
+         * @param out Filled with the distinct node of every copy
+         */
+        virtual void nodesFor(const Key& key, size_t chunk, size_t nodes, size_t copies, size_t* out) {
+            size_t home = nodeFor(key, chunk, nodes);
+            for (size_t i = 0; i < copies; i++) {
+                out[i] = (home + i) % nodes;
+            }
+        }
+};
+
+/**
+ * Places chunk i on node i % nodes
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class ModuloPlacement: public PlacementPolicy {
+    public:
+
+        /** Provides the home node of a chunk. See PlacementPolicy::nodeFor */
+        virtual size_t nodeFor(const Key& key, size_t chunk, size_t nodes) { return chunk % nodes; }
+};
+
+/**
+ * Places chunks on a consistent hashing ring. Every node owns a number of virtual nodes on the ring and a chunk
+ * belongs to the first virtual node at or after the chunk's hash. Adding a node only moves the chunks that the
+ * new node's virtual nodes take over, and the dataframe name is part of the hash so small dataframes spread out
+ * instead of all starting on node 0.
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class ConsistentHashPlacement: public PlacementPolicy {
+    public:
+
+        /** The number of points each node has on the ring. This keeps the load within a few percent across nodes */
+        static const size_t VIRTUAL_NODES = 2048;
+
+        /** The ring of (position, node) pairs ordered by position for every cluster size that has been seen */
+        std::map<size_t, std::vector<std::pair<uint64_t, uint32_t>>> _rings;
+
+        /** Mutex for the rings */
+        std::mutex _mutex;
+
+        /** Provides the home node of a chunk. See PlacementPolicy::nodeFor */
+        virtual size_t nodeFor(const Key& key, size_t chunk, size_t nodes) {
+            size_t home;
+            nodesFor(key, chunk, nodes, 1, &home);
+            return home;
+        }
+
+        /** Provides the nodes of the copies of a chunk, walking the ring past the home node. See PlacementPolicy::nodesFor */
+        virtual void nodesFor(const Key& key, size_t chunk, size_t nodes, size_t copies, size_t* out) {
+            uint64_t position = mix64((key.getId() >> 8) ^ mix64(chunk));
+            const std::vector<std::pair<uint64_t, uint32_t>>& ring = _ringFor(nodes);
+
+            size_t start = std::lower_bound(ring.begin(), ring.end(), std::make_pair(position, (uint32_t)0)) - ring.begin();
+            size_t found = 0;
+            for (size_t i = 0; found < copies; i++) {
+                uint32_t node = ring[(start + i) % ring.size()].second;
+                if (std::find(out, out + found, node) == out + found) {
+                    out[found++] = node;
+                }
+            }
+        }
+
+        /**
+         * Provides the ring for the given number of nodes, building it the first time. Rings are never changed
+         * once they are built, so they can be read without holding the mutex
+         * @param nodes The number of nodes in the cluster
+         */
+        const std::vector<std::pair<uint64_t, uint32_t>>& _ringFor(size_t nodes) {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            std::vector<std::pair<uint64_t, uint32_t>>& ring = _rings[nodes];
+            if (ring.empty()) {
+                for (uint32_t node = 0; node < nodes; node++) {
+                    for (uint64_t point = 0; point < VIRTUAL_NODES; point++) {
+                        ring.push_back(std::make_pair(mix64(((uint64_t)node << 32) | point), node));
+                    }
+                }
+
+                std::sort(ring.begin(), ring.end());
+            }
+
+            return ring;
+        }
+};
+
+/**
+ * Places every chunk on one node, so that a dataframe that a node builds from its own results stays on it
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class LocalPlacement: public PlacementPolicy {
+    public:
+
+        /** The node every chunk is homed on */
+        size_t _node;
+
+        /**
+         * Default constructor
+         * @param node The node every chunk is homed on
+         */
+        LocalPlacement(size_t node) : _node(node) {}
+
+        /** Provides the home node of a chunk. See PlacementPolicy::nodeFor */
+        virtual size_t nodeFor(const Key& key, size_t chunk, size_t nodes) { return _node < nodes ? _node : chunk % nodes; }
+};
+
+/**
+ * Places every chunk on the home node of the rows at the same position in another dataframe, so that the rows of the
+ * two can be read together without going over the network
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class ColocatedPlacement: public PlacementPolicy {
+    public:
+
+        /** The home node of every chunk of the other dataframe */
+        std::vector<size_t> _homes;
+
+        /** The number of rows in every chunk of the other dataframe but the last */
+        size_t _withChunkRows;
+
+        /** The number of rows in every chunk of the dataframe being placed but the last */
+        size_t _chunkRows;
+
+        /**
+         * Default constructor
+         * @param homes The home node of every chunk of the other dataframe
+         * @param withChunkRows The number of rows in every chunk of the other dataframe but the last
+         * @param chunkRows The number of rows in every chunk of the dataframe being placed but the last
+         */
+        ColocatedPlacement(std::vector<size_t> homes, size_t withChunkRows, size_t chunkRows) :
+            _homes(homes), _withChunkRows(withChunkRows ? withChunkRows : 1), _chunkRows(chunkRows) {}
+
+        /**
+         * Provides the home node of a chunk. Chunks past the end of the other dataframe are homed with its last chunk.
+         * See PlacementPolicy::nodeFor
+         */
+        virtual size_t nodeFor(const Key& key, size_t chunk, size_t nodes) {
+            if (_homes.empty()) { return chunk % nodes; }
+
+            size_t with = std::min(chunk * _chunkRows / _withChunkRows, _homes.size() - 1);
+            return _homes[with] < nodes ? _homes[with] : chunk % nodes;
+        }
+};
+
+/**
+ * Asks for the chunks of a dataframe that is being stored to be homed somewhere other than where the store's
+ * placement policy puts them
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class PlacementHint {
+    public:
+
+        /** Where the chunks are asked to be homed */
+        enum Kind { DEFAULT, LOCAL, COLOCATED };
+
+        /** Where the chunks are asked to be homed */
+        Kind kind;
+
+        /** The key of the dataframe to home the chunks with when COLOCATED. Not owned */
+        Key* with;
+
+        /** Creates a hint that leaves the chunks to the store's placement policy */
+        PlacementHint() : kind(DEFAULT), with(nullptr) {}
+
+        /** Provides a hint that homes every chunk on the node that stores the dataframe */
+        static PlacementHint local() { return PlacementHint(LOCAL, nullptr); }
+
+        /**
+         * Provides a hint that homes every chunk with the rows at the same position in another dataframe
+         * @param with The key of the other dataframe. Must outlive the hint
+         */
+        static PlacementHint colocatedWith(Key& with) { return PlacementHint(COLOCATED, &with); }
+
+        /** Determines if the chunks are left to the store's placement policy */
+        bool isDefault() const { return kind == DEFAULT; }
+
+    private:
+
+        PlacementHint(Kind kind, Key* with) : kind(kind), with(with) {}
+};
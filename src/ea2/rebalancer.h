@@ -0,0 +1,258 @@
+#pragma once
+
+// Language: C++
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kvstore/kvstore.h"
+#include "dataframe_description.h"
+
+/**
+ * Moves the chunks of the dataframes whose descriptions are stored on this node when nodes join the cluster, so that
+ * new nodes hold their share of the chunks and do their share of every local map. Chunks are placed again with the
+ * node's placement policy, and the copies that moved are written to their new nodes in the background, no faster than
+ * a set number of bytes a second. The new description is published with a single conditional put once every copy is
+ * written, so readers see either the old placement or the new one. The copies that are no longer used are expired
+ * rather than removed, since readers that hold the old description may still read them. Readers that find them gone
+ * read the new description
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class Rebalancer {
+    public:
+
+        /** The number of bytes of chunks that are moved a second by default */
+        static const size_t DEFAULT_RATE = 64 * 1024 * 1024;
+
+        /** The store whose dataframes are rebalanced */
+        KVStore& _store;
+
+        /** The most bytes of chunks that are moved a second */
+        std::atomic<size_t> _rate;
+
+        /** True if the cluster changed since the last pass started */
+        bool _pending = false;
+
+        /** True once the thread should exit */
+        std::atomic<bool> _stopping;
+
+        /** Mutex for _pending, and for _stopping while the thread waits */
+        std::mutex _mutex;
+
+        /** Signalled when a pass is scheduled or the thread should exit */
+        std::condition_variable _scheduled;
+
+        /** The thread that moves chunks */
+        std::thread _thread;
+
+        /** The number of passes over the dataframes on this node that have finished */
+        std::atomic<size_t> passes;
+
+        /** The number of copies of chunks that were moved to another node */
+        std::atomic<size_t> movedChunks;
+
+        /** The number of bytes of chunks that were moved to another node */
+        std::atomic<size_t> movedBytes;
+
+        /**
+         * Default constructor
+         * @param store The store whose dataframes are rebalanced
+         * @param rate The most bytes of chunks that are moved a second
+         */
+        Rebalancer(KVStore& store, size_t rate = DEFAULT_RATE) : _store(store), _rate(rate), _stopping(false), passes(0),
+                                                                  movedChunks(0), movedBytes(0) {
+            _thread = std::thread([this] { _run(); });
+        }
+
+        /** Stops the thread. A pass that is running finishes the dataframe it is on first */
+        ~Rebalancer() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+
+            _scheduled.notify_all();
+            _thread.join();
+        }
+
+        /** Starts a pass over the dataframes on this node, or another one once the current pass is done */
+        void schedule() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _pending = true;
+            }
+
+            _scheduled.notify_all();
+        }
+
+        /**
+         * Changes how fast chunks are moved
+         * @param rate The most bytes of chunks that are moved a second
+         */
+        void setRate(size_t rate) { _rate = rate; }
+
+        /** Runs a pass every time one is scheduled until the thread should exit */
+        void _run() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _scheduled.wait(lock, [&] { return _stopping || _pending; });
+                if (_stopping) { return; }
+
+                _pending = false;
+                lock.unlock();
+                _pass();
+                lock.lock();
+            }
+        }
+
+        /** Rebalances every dataframe whose description is stored on this node */
+        void _pass() {
+            std::vector<Key*> keys = _store._byteStore._scanLocal("");
+            for (Key* key : keys) {
+                // A description that was replaced while its chunks were moving is read again
+                while (!_stopping && !_rebalance(*key)) {}
+                delete key;
+            }
+
+            passes++;
+        }
+
+        /**
+         * Moves the chunks of a dataframe to where the placement policy puts them in the cluster as it is now
+         * @param key The key of the dataframe
+         * @return false if another write replaced the description first, in which case nothing was changed
+         */
+        bool _rebalance(Key& key) {
+            ByteArray* bytes = _store._byteStore.get(key);
+            if (!bytes) { return true; }
+
+            uint64_t version = bytes->version;
+            Deserializer deserializer(bytes->length, bytes->contents);
+            DataframeDescription old;
+            old.deserialize(deserializer);
+            delete bytes;
+
+            // The rows of a small dataframe are in its description, so there is nothing to move. Chunks that were homed
+            // where a hint asked for stay there
+            if (old.isInline() || old.pinned) { return true; }
+
+            size_t nodes = _store._byteStore.nodes();
+            size_t copies = old.replication;
+            if (copies > nodes) { return true; }
+
+            DataframeDescription* desc = dynamic_cast<DataframeDescription*>(old.clone());
+            std::vector<size_t> homes(copies);
+            std::vector<Key*> written;
+            std::vector<Key*> replaced;
+            auto started = std::chrono::steady_clock::now();
+            size_t moved = 0;
+
+            bool lost = false;
+            for (size_t chunk = 0; chunk < old.chunks && !_stopping && !lost; chunk++) {
+                _store._homesFor(key, chunk, nodes, copies, homes.data());
+
+                for (size_t copy = 0; copy < copies; copy++) {
+                    desc->nodes[chunk * copies + copy] = (uint8_t)homes[copy];
+                }
+
+                for (size_t col = 0; col < old.columns() && !lost; col++) {
+                    for (size_t copy = 0; copy < copies; copy++) {
+                        if (!_holds(*desc, chunk, old.nodeOf(chunk, copy))) { replaced.push_back(old.keyFor(col, chunk, copy)); }
+                        if (_holds(old, chunk, homes[copy])) { continue; }
+
+                        Key* target = desc->keyFor(col, chunk, copy);
+                        written.push_back(target);
+
+                        // A chunk that is gone from every node can not be moved, so the dataframe is left as it is
+                        size_t length;
+                        if (!_copy(old, col, chunk, *target, length)) {
+                            lost = true;
+                            break;
+                        }
+
+                        moved += length;
+                        movedChunks++;
+                        movedBytes += length;
+                        _throttle(started, moved);
+                    }
+                }
+            }
+
+            bool published = !_stopping && !lost;
+            if (published && !written.empty()) {
+                Serializer serializer;
+                desc->serialize(serializer);
+                published = _store._byteStore.putIfVersion(serializer.getBuffer(), serializer.getSize(), key, version) != 0;
+            }
+
+            // The copies that were written for a description that was not published are never read
+            for (Key* target : written) {
+                if (!published) { _store._byteStore.remove(*target); }
+                delete target;
+            }
+
+            for (Key* source : replaced) {
+                if (published && !written.empty()) { _store._byteStore.expire(*source, KVStore::REPLACED_CHUNK_TTL); }
+                delete source;
+            }
+
+            delete desc;
+            return published || _stopping || lost;
+        }
+
+        /**
+         * Determines if a node holds a copy of a chunk
+         * @param desc The description of the dataframe
+         * @param chunk The index of the chunk
+         * @param node The node
+         */
+        static bool _holds(const DataframeDescription& desc, size_t chunk, size_t node) {
+            for (size_t copy = 0; copy < desc.replication; copy++) {
+                if (desc.nodeOf(chunk, copy) == node) { return true; }
+            }
+
+            return false;
+        }
+
+        /**
+         * Copies a chunk of a column from the first of its current copies that is found to a new key
+         * @param desc The description the chunk is read through
+         * @param column The index of the column
+         * @param chunk The index of the chunk
+         * @param target The key to write the copy under
+         * @param length Set to the number of bytes that were copied
+         * @return false if no copy of the chunk was found
+         */
+        bool _copy(const DataframeDescription& desc, size_t column, size_t chunk, Key& target, size_t& length) {
+            ByteArray* data = nullptr;
+            for (size_t copy = 0; !data && copy < desc.replication; copy++) {
+                Key* source = desc.keyFor(column, chunk, copy);
+                data = _store._byteStore.get(*source);
+                delete source;
+            }
+
+            if (!data) { return false; }
+
+            length = data->length;
+            _store._byteStore.put(data->contents, length, target);
+            delete data;
+            return true;
+        }
+
+        /**
+         * Waits until moving the chunks so far has taken as long as it should at the rate
+         * @param started When the chunks started moving
+         * @param moved The number of bytes that were moved since then
+         */
+        void _throttle(std::chrono::steady_clock::time_point started, size_t moved) {
+            size_t rate = _rate;
+            if (!rate) { return; }
+
+            auto due = started + std::chrono::microseconds((uint64_t)((double)moved / rate * 1000000));
+            std::this_thread::sleep_until(due);
+        }
+};
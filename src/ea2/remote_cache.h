@@ -0,0 +1,191 @@
+#pragma once
+
+// Language: C++
+
+#include <list>
+#include <mutex>
+
+#include "../utils/datastructures/map.h"
+#include "../utils/key.h"
+#include "byte_array.h"
+
+/**
+ * A single cached copy of a remote value
+ * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
+ */
+class CacheEntry: public Object {
+    public:
+
+        /** The key the value is stored under. Owned by the entry */
+        Key* key;
+
+        /** The cached bytes. Owned by the entry */
+        char* contents;
+
+        /** The length of the cached bytes */
+        size_t length;
+
+        /** The version of the value on its home node */
+        uint64_t version;
+
+        /** The location of this entry in the recency list */
+        std::list<CacheEntry*>::iterator position;
+
+        /** Default constructor */
+        CacheEntry(Key* key, char* contents, size_t length, uint64_t version) : key(key), contents(contents),
+                                                                                length(length), version(version) {}
+
+        ~CacheEntry() {
+            delete key;
+            delete[] contents;
+        }
+};
+
+/**
+ * A node wide cache of values that live on other nodes. Values are stamped with the version they had on their
+ * home node, so a reader that knows which version it expects never sees a value that has since been re-put.
+ * The cache is bounded in bytes and evicts the least recently used values first.
+ * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
+ */
+class RemoteCache {
+    public:
+
+        /** The default number of bytes that the cache will hold */
+        static const size_t DEFAULT_CAPACITY = 256 * 1024 * 1024;
+
+        /** The cached values. Maps Key to CacheEntry */
+        Map _entries;
+
+        /** The entries ordered from most to least recently used */
+        std::list<CacheEntry*> _recency;
+
+        /** Mutex for the entries and the recency list */
+        std::mutex _mutex;
+
+        /** The maximum number of bytes that can be cached */
+        size_t _capacity;
+
+        /** The number of bytes currently cached */
+        size_t _size = 0;
+
+        /** The number of lookups that were answered by the cache */
+        size_t hits = 0;
+
+        /** The number of lookups that were not answered by the cache */
+        size_t misses = 0;
+
+        /** The number of values that were evicted to make space */
+        size_t evictions = 0;
+
+        /**
+         * Default constructor
+         * @param capacity The maximum number of bytes to cache
+         */
+        RemoteCache(size_t capacity = DEFAULT_CAPACITY) : _capacity(capacity) {}
+
+        ~RemoteCache() {
+            for (CacheEntry* entry : _recency) { delete entry; }
+        }
+
+        /**
+         * Provides a copy of the cached value for the key if one exists that is at least as new as the given version
+         * @param key The key of the value
+         * @param version The version the caller expects
+         * @return A copy of the value, or nullptr if there is no usable cached value. The caller owns the copy
+         */
+        ByteArray* get(Key& key, uint64_t version) {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            CacheEntry* entry = dynamic_cast<CacheEntry*>(_entries.get(&key));
+            if (!entry || entry->version < version) {
+                misses++;
+                return nullptr;
+            }
+
+            hits++;
+            _recency.splice(_recency.begin(), _recency, entry->position);
+
+            char* copy = new char[entry->length];
+            memcpy(copy, entry->contents, sizeof(char) * entry->length);
+
+            ByteArray* bytes = new ByteArray(copy, entry->length);
+            bytes->version = entry->version;
+            return bytes;
+        }
+
+        /**
+         * Caches a copy of a value. Values larger than the capacity of the cache are not cached
+         * @param key The key of the value
+         * @param contents The value
+         * @param length The length of the value in bytes
+         * @param version The version of the value on its home node
+         */
+        void put(Key& key, const char* contents, size_t length, uint64_t version) {
+            if (length > _capacity) { return; }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            CacheEntry* existing = dynamic_cast<CacheEntry*>(_entries.get(&key));
+            if (existing) {
+                if (existing->version >= version) { return; }
+                _remove(existing);
+            }
+
+            while (_size + length > _capacity) {
+                evictions++;
+                _remove(_recency.back());
+            }
+
+            char* copy = new char[length];
+            memcpy(copy, contents, sizeof(char) * length);
+
+            CacheEntry* entry = new CacheEntry((Key*)key.clone(), copy, length, version);
+            _recency.push_front(entry);
+            entry->position = _recency.begin();
+            _entries.put(entry->key, entry);
+            _size += length;
+        }
+
+        /**
+         * Drops the cached value for the key if there is one
+         * @param key The key of the value to drop
+         */
+        void invalidate(Key& key) {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            CacheEntry* existing = dynamic_cast<CacheEntry*>(_entries.get(&key));
+            if (existing) { _remove(existing); }
+        }
+
+        /**
+         * Changes the maximum number of bytes the cache can hold. Evicts values if the cache is now too large
+         * @param capacity The new capacity in bytes
+         */
+        void setCapacity(size_t capacity) {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _capacity = capacity;
+            while (_size > _capacity) {
+                evictions++;
+                _remove(_recency.back());
+            }
+        }
+
+        /** Provides the number of bytes that are currently cached */
+        size_t size() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _size;
+        }
+
+        /**
+         * Removes an entry from the cache and frees it. The mutex must be held
+         * @param entry The entry to remove
+         */
+        void _remove(CacheEntry* entry) {
+            delete _entries.remove(entry->key);
+            _recency.erase(entry->position);
+            _size -= entry->length;
+            delete entry;
+        }
+
+};
@@ -283,15 +283,19 @@ public:
    */
   size_t merge(Set& set, char const* name, int stage) {
     if (this_node() == 0) {
-      for (size_t i = 1; i < NUM_NODES; ++i) {
-        Key nK(StrBuff(name).c(stage).c("-").c(i).get());
-        DataFrame* delta = kv.waitAndGet(nK);
+      // Deltas are merged in whatever order the nodes finish them
+      String* prefix = StrBuff(name).c(stage).c("-").get();
+      kv.gather(prefix->c_str(), NUM_NODES - 1, [&](Key& nK, DataFrame* delta) {
         p("    received delta of ").p(delta->nrows())
-          .p(" elements from node ").pln(i);
+          .p(" elements from ").pln(nK.getName());
         SetUpdater upd(set);
         delta->map(upd);
         delete delta;
-      }
+
+        // The delta is only needed for this merge
+        kv.remove(nK);
+      });
+      delete prefix;
       p("    storing ").p(set.size()).pln(" merged elements");
       SetWriter writer(set);
       Key k(StrBuff(name).c(stage).c("-0").get());
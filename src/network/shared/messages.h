@@ -89,6 +89,16 @@ class Message {
 
         virtual ~Message() { delete[] contents; }
 
+        /**
+         * Takes the contents away from this message so that they can be kept after the message is deleted
+         * @return The contents, allocated with new[]. The caller owns them
+         */
+        const char* steal() {
+            const char* stolen = contents;
+            contents = nullptr;
+            return stolen;
+        }
+
         /**
          * Create a new deserializaer for this message
          * @return A deserializer for this message
@@ -316,7 +326,17 @@ enum KBMessageType: uint8_t {
     PUT,
     GET,
     GET_AND_WAIT,
-    RESPONSE_DATA
+    RESPONSE_DATA,
+    REMOVE,
+    REMOVE_PREFIX,
+    EXPIRE,
+    PUT_IF_CONTENT,
+    SCAN,
+    PUT_IF_VERSION,
+    GET_IF_NEWER,
+    FILTER,
+    DISTRIBUTED_MAP,
+    GET_DATAFRAME
 };
 
 /**
@@ -329,19 +349,28 @@ class KBMessage: public Codable {
         /** Use a string since the serializer already knows how to handle that */
         char* _data = nullptr;
 
+        /** True if this message owns _data. Messages that are viewed point into the buffer they were read from */
+        bool _ownsData = true;
+
         /** The length in bytes of data */
         uint64_t _length;
 
         /** The type of KBStore message that this is */
         KBMessageType _kbMessageType;
 
+        /** The id of the key that the message is about. 0 if it is not about a single key */
+        uint64_t _key = 0;
+
         /**
          * Default constructor
          * @param type The type of message that this is
          * @param data The data for this message
          * @param length The length of the data in bytes
+         * @param key Optional. The id of the key that the message is about
          */
-        KBMessage(KBMessageType type, const char* data, size_t length) : _length(length), _kbMessageType(type) {
+        KBMessage(KBMessageType type, const char* data, size_t length, uint64_t key = 0) : _length(length),
+                                                                                           _kbMessageType(type),
+                                                                                           _key(key) {
             _data = new char[length];
             memcpy(_data, data, sizeof(char) * length);
         }
@@ -350,7 +379,7 @@ class KBMessage: public Codable {
         KBMessage() {}
 
         ~KBMessage() {
-            delete[] _data;
+            if (_ownsData) { delete[] _data; }
         }
 
         /**
@@ -358,8 +387,9 @@ class KBMessage: public Codable {
          * @param serializer buffer to write to
          */
         virtual void serialize(Serializer& serializer) {
-            MessageHeader(sizeof(_length) + sizeof(char) * _length + sizeof(uint8_t), DATA).serialize(serializer);
+            MessageHeader(sizeof(_length) + sizeof(_key) + sizeof(char) * _length + sizeof(uint8_t), DATA).serialize(serializer);
             serializer.write((uint8_t)_kbMessageType);
+            serializer.write(_key);
             serializer.write(_length);
             serializer._write(_data, sizeof(char) * _length);
         }
@@ -374,10 +404,29 @@ class KBMessage: public Codable {
             assert(header.messageType == DATA);
 
             _kbMessageType = (KBMessageType)deserializer.read_uint8();
+            _key = deserializer.read_uint64();
             _length = deserializer.read_uint64();
             _data = deserializer.read(sizeof(char) * _length);
         }
 
+        /**
+         * Reads the message from a buffer without copying its data. The data points into the buffer, so the buffer
+         * must outlive this message
+         * @param deserializer The buffer to read from
+         */
+        void view(Deserializer& deserializer) {
+            MessageHeader header;
+            header.deserialize(deserializer);
+            assert(header.messageType == DATA);
+
+            _kbMessageType = (KBMessageType)deserializer.read_uint8();
+            _key = deserializer.read_uint64();
+            _length = deserializer.read_uint64();
+            _data = (char*)deserializer.head();
+            _ownsData = false;
+            deserializer._deserialize(sizeof(char) * _length);
+        }
+
         /**
          * Provides the type of KBStore message that this is
          */
@@ -385,6 +434,9 @@ class KBMessage: public Codable {
             return _kbMessageType;
         }
 
+        /** Provides the id of the key that the message is about */
+        uint64_t getKey() const { return _key; }
+
         /**
          * Provides the data in this message
          * @return The data of the message
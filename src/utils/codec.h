@@ -0,0 +1,260 @@
+#pragma once
+
+// Language: C++
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * A fast in-memory compressor for stored values. Bytes are first shuffled so that the same byte of every fixed size
+ * element sits together, which turns the mostly zero high bytes of small numbers into long runs, and are then
+ * compressed with a greedy LZ77 style matcher.
+ *
+ * The compressed form is a header of the original length and the shuffle stride, followed by tokens of a run of
+ * literal bytes and a back reference. Lengths and offsets are written as variable length integers.
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class Codec {
+    public:
+
+        /** The length in bytes of the header */
+        static const size_t HEADER_SIZE = sizeof(uint64_t) + sizeof(uint8_t);
+
+        /** The shortest back reference that is written */
+        static const size_t MIN_MATCH = 4;
+
+        /** The number of bits used to hash the bytes at a position */
+        static const size_t HASH_BITS = 14;
+
+        /**
+         * Compresses bytes
+         * @param contents The bytes to compress
+         * @param length The number of bytes
+         * @param stride The size of the elements the bytes are made of. 1 to not shuffle the bytes
+         * @param compressedLength Set to the length of the compressed bytes
+         * @return The compressed bytes, allocated with new[], or nullptr if they would not be smaller than the input
+         */
+        static char* compress(const char* contents, size_t length, size_t stride, size_t& compressedLength) {
+            const char* input = contents;
+            char* shuffled = nullptr;
+            if (stride > 1 && length >= stride) {
+                shuffled = new char[length];
+                shuffle(contents, length, stride, shuffled);
+                input = shuffled;
+            }
+
+            char* output = new char[length];
+            size_t written = 0;
+            bool fits = length > HEADER_SIZE;
+            if (fits) {
+                memcpy(output, &length, sizeof(uint64_t));
+                output[sizeof(uint64_t)] = (char)(shuffled ? stride : 1);
+                written = _compress(input, length, output + HEADER_SIZE, length - HEADER_SIZE);
+                fits = written != 0;
+            }
+
+            delete[] shuffled;
+            if (!fits) {
+                delete[] output;
+                return nullptr;
+            }
+
+            compressedLength = HEADER_SIZE + written;
+            return output;
+        }
+
+        /**
+         * Provides the length that compressed bytes decompress to
+         * @param compressed The compressed bytes
+         */
+        static size_t decompressedLength(const char* compressed) {
+            uint64_t length;
+            memcpy(&length, compressed, sizeof(uint64_t));
+            return length;
+        }
+
+        /**
+         * Decompresses bytes made by compress
+         * @param compressed The compressed bytes
+         * @param compressedLength The number of compressed bytes
+         * @param length Set to the length of the decompressed bytes
+         * @return The decompressed bytes, allocated with new[]
+         */
+        static char* decompress(const char* compressed, size_t compressedLength, size_t& length) {
+            length = decompressedLength(compressed);
+            size_t stride = (uint8_t)compressed[sizeof(uint64_t)];
+
+            char* output = new char[length];
+            if (stride <= 1) {
+                _decompress(compressed + HEADER_SIZE, compressedLength - HEADER_SIZE, output, length);
+                return output;
+            }
+
+            char* shuffled = new char[length];
+            _decompress(compressed + HEADER_SIZE, compressedLength - HEADER_SIZE, shuffled, length);
+            unshuffle(shuffled, length, stride, output);
+            delete[] shuffled;
+            return output;
+        }
+
+        /**
+         * Groups byte b of every element together. Bytes after the last whole element are kept at the end
+         * @param input The bytes to shuffle
+         * @param length The number of bytes
+         * @param stride The size of an element
+         * @param output Where to write the shuffled bytes. Must hold length bytes
+         */
+        static void shuffle(const char* input, size_t length, size_t stride, char* output) {
+            size_t elements = length / stride;
+            for (size_t i = 0; i < elements; i++) {
+                for (size_t b = 0; b < stride; b++) {
+                    output[b * elements + i] = input[i * stride + b];
+                }
+            }
+
+            memcpy(output + elements * stride, input + elements * stride, length - elements * stride);
+        }
+
+        /**
+         * Undoes shuffle
+         * @param input The shuffled bytes
+         * @param length The number of bytes
+         * @param stride The size of an element
+         * @param output Where to write the original bytes. Must hold length bytes
+         */
+        static void unshuffle(const char* input, size_t length, size_t stride, char* output) {
+            size_t elements = length / stride;
+            for (size_t b = 0; b < stride; b++) {
+                for (size_t i = 0; i < elements; i++) {
+                    output[i * stride + b] = input[b * elements + i];
+                }
+            }
+
+            memcpy(output + elements * stride, input + elements * stride, length - elements * stride);
+        }
+
+        /**
+         * Writes a variable length integer, 7 bits per byte
+         * @param value The value to write
+         * @param output Where to write it
+         * @param written The number of bytes written to output so far. Advanced past the integer
+         * @param capacity The number of bytes output can hold
+         * @return false if the integer does not fit
+         */
+        static bool _writeVarint(uint64_t value, char* output, size_t& written, size_t capacity) {
+            do {
+                if (written == capacity) { return false; }
+
+                uint8_t byte = value & 0x7f;
+                value >>= 7;
+                output[written++] = (char)(value ? byte | 0x80 : byte);
+            } while (value);
+
+            return true;
+        }
+
+        /**
+         * Reads a variable length integer
+         * @param input The bytes to read from
+         * @param read The number of bytes read so far. Advanced past the integer
+         * @return The integer
+         */
+        static uint64_t _readVarint(const char* input, size_t& read) {
+            uint64_t value = 0;
+            for (size_t shift = 0; ; shift += 7) {
+                uint8_t byte = (uint8_t)input[read++];
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) { return value; }
+            }
+        }
+
+        /** Hashes the MIN_MATCH bytes at a position */
+        static size_t _hash(const char* at) {
+            uint32_t word;
+            memcpy(&word, at, sizeof(uint32_t));
+            return (word * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        /**
+         * Compresses bytes into tokens
+         * @param input The bytes to compress
+         * @param length The number of bytes
+         * @param output Where to write the tokens
+         * @param capacity The number of bytes output can hold
+         * @return The number of bytes written, or 0 if the tokens do not fit
+         */
+        static size_t _compress(const char* input, size_t length, char* output, size_t capacity) {
+            size_t* table = new size_t[1 << HASH_BITS]();
+            size_t written = 0;
+            size_t literals = 0;
+            size_t position = 0;
+            bool fits = true;
+
+            while (fits && position + MIN_MATCH <= length) {
+                size_t hash = _hash(input + position);
+                size_t candidate = table[hash];
+                table[hash] = position;
+
+                if (candidate >= position || memcmp(input + candidate, input + position, MIN_MATCH)) {
+                    position++;
+                    continue;
+                }
+
+                size_t match = MIN_MATCH;
+                while (position + match < length && input[candidate + match] == input[position + match]) { match++; }
+
+                size_t run = position - literals;
+                fits = _writeVarint(run, output, written, capacity) && written + run <= capacity;
+                if (fits) {
+                    memcpy(output + written, input + literals, run);
+                    written += run;
+                    fits = _writeVarint(match - MIN_MATCH, output, written, capacity)
+                           && _writeVarint(position - candidate, output, written, capacity);
+                }
+
+                position += match;
+                literals = position;
+            }
+
+            size_t run = length - literals;
+            fits = fits && _writeVarint(run, output, written, capacity) && written + run <= capacity;
+            if (fits) {
+                memcpy(output + written, input + literals, run);
+                written += run;
+            }
+
+            delete[] table;
+            return fits ? written : 0;
+        }
+
+        /**
+         * Decompresses tokens
+         * @param input The tokens
+         * @param length The number of bytes of tokens
+         * @param output Where to write the bytes
+         * @param capacity The number of bytes the tokens decompress to
+         */
+        static void _decompress(const char* input, size_t length, char* output, size_t capacity) {
+            size_t read = 0;
+            size_t written = 0;
+            while (true) {
+                size_t run = _readVarint(input, read);
+                memcpy(output + written, input + read, run);
+                read += run;
+                written += run;
+
+                if (written == capacity) { break; }
+
+                size_t match = _readVarint(input, read) + MIN_MATCH;
+                size_t offset = _readVarint(input, read);
+
+                // Matches can overlap the bytes they produce, so they are copied one byte at a time
+                for (size_t i = 0; i < match; i++, written++) {
+                    output[written] = output[written - offset];
+                }
+            }
+
+            assert(read == length);
+        }
+};
@@ -28,6 +28,9 @@ public:
     /** The hash value of the key */
     size_t hash;
 
+    /** The position of this entry inside of the map's entry set */
+    size_t position = 0;
+
     /**
      * Creates a new entry
      * @param key The key of the entry
@@ -94,6 +97,7 @@ public:
         }
 
         Entry* newEntry = new Entry(key, val);
+        newEntry->position = _entrySet.size();
         _entrySet.push_back(newEntry);
         _put(newEntry);
 
@@ -109,7 +113,7 @@ public:
         size_t resizeThreshold = (float)_array.size() * 0.75;
         if (resizeThreshold <= (_entrySet.size() + 1)) {
             for (size_t i = 0; i < _array.size(); i++) {
-                _array[i].empty();
+                _array[i].clear();
             }
 
             size_t size = _array.size();
@@ -166,6 +170,35 @@ public:
         return nullptr;
     }
 
+    /**
+     * Removes the mapping for the given key. The key and value inside of the map are not deleted, the
+     * removed entry is returned so that the caller can free them
+     * @param key The key of the mapping to remove
+     * @return The removed entry or nullptr if the key was not in the map. The caller owns the entry
+     */
+    Entry* remove(Object* key) {
+        _mutex.lock();
+
+        Entry* entry = _getEntry(key);
+        if (entry) {
+            std::vector<Entry*>& bucketArr = _array[entry->hash % _array.size()];
+            for (size_t i = 0; i < bucketArr.size(); i++) {
+                if (bucketArr[i] == entry) {
+                    bucketArr.erase(bucketArr.begin() + i);
+                    break;
+                }
+            }
+
+            Entry* last = _entrySet.back();
+            _entrySet[entry->position] = last;
+            last->position = entry->position;
+            _entrySet.pop_back();
+        }
+
+        _mutex.unlock();
+        return entry;
+    }
+
     /**
      * Returns true if this map contains the given key
      * @param key The key whose presence in this map is to be tested
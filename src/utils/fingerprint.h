@@ -0,0 +1,90 @@
+#pragma once
+
+// Language: C++
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * A 128 bit hash of a series of bytes that is used to recognize bytes that have already been stored. Computed like
+ * MurmurHash3's x64 128 bit variant
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class Fingerprint {
+    public:
+
+        /** The upper 64 bits of the hash */
+        uint64_t high = 0;
+
+        /** The lower 64 bits of the hash */
+        uint64_t low = 0;
+
+        /** Constructor for deserialization */
+        Fingerprint() {}
+
+        /**
+         * Hashes a series of bytes
+         * @param contents The bytes to hash
+         * @param length The number of bytes
+         */
+        Fingerprint(const char* contents, size_t length) {
+            const uint64_t c1 = 0x87c37b91114253d5ULL;
+            const uint64_t c2 = 0x4cf5ad432745937fULL;
+            uint64_t h1 = 0;
+            uint64_t h2 = 0;
+
+            size_t blocks = length / 16;
+            for (size_t i = 0; i < blocks; i++) {
+                uint64_t k1, k2;
+                memcpy(&k1, contents + i * 16, sizeof(uint64_t));
+                memcpy(&k2, contents + i * 16 + 8, sizeof(uint64_t));
+
+                h1 ^= _rotate(k1 * c1, 31) * c2;
+                h1 = (_rotate(h1, 27) + h2) * 5 + 0x52dce729;
+                h2 ^= _rotate(k2 * c2, 33) * c1;
+                h2 = (_rotate(h2, 31) + h1) * 5 + 0x38495ab5;
+            }
+
+            // The tail is zero padded into two final words
+            uint64_t tail[2] = {0, 0};
+            memcpy(tail, contents + blocks * 16, length - blocks * 16);
+            h1 ^= _rotate(tail[0] * c1, 31) * c2;
+            h2 ^= _rotate(tail[1] * c2, 33) * c1;
+
+            h1 ^= length;
+            h2 ^= length;
+            h1 += h2;
+            h2 += h1;
+            h1 = _finalize(h1);
+            h2 = _finalize(h2);
+            h1 += h2;
+            h2 += h1;
+
+            high = h1;
+            low = h2;
+        }
+
+        bool operator==(const Fingerprint& other) const { return high == other.high && low == other.low; }
+
+        bool operator<(const Fingerprint& other) const {
+            return high < other.high || (high == other.high && low < other.low);
+        }
+
+        /** Rotates the bits of a word to the left */
+        static uint64_t _rotate(uint64_t word, int bits) { return (word << bits) | (word >> (64 - bits)); }
+
+        /** Mixes the bits of a word so that every input bit affects every output bit */
+        static uint64_t _finalize(uint64_t word) {
+            word ^= word >> 33;
+            word *= 0xff51afd7ed558ccdULL;
+            word ^= word >> 33;
+            word *= 0xc4ceb93fe53ec1a7ULL;
+            word ^= word >> 33;
+            return word;
+        }
+
+        /** Hashes fingerprints for unordered containers */
+        struct Hash {
+            size_t operator()(const Fingerprint& fingerprint) const { return fingerprint.low; }
+        };
+};
@@ -1,14 +1,115 @@
 #pragma once
 
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "instructor-provided/string.h"
+
+/** A compact identifier for a key. The upper 56 bits are a hash of the name and the lower 8 bits are the home node */
+typedef uint64_t KeyId;
+
+/**
+ * The process wide side table of key names. Keys only carry their id over the network, so names are interned here
+ * when a named key is serialized so that keys rebuilt from an id in this process can still be named. A name is
+ * forgotten once the value under its key is removed from the store, so the table only grows with the live keys
+ * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
+ */
+class KeyNames {
+    public:
+
+        /** The interned names */
+        std::unordered_map<KeyId, String*> _names;
+
+        /** Mutex for _names */
+        std::mutex _mutex;
+
+        ~KeyNames() {
+            for (auto& name : _names) {
+                delete name.second;
+            }
+        }
+
+        /** Provides the side table for this process. Never destroyed, since detached threads may use it until the very end */
+        static KeyNames& shared() {
+            static KeyNames* names = new KeyNames();
+            return *names;
+        }
+
+        /**
+         * Records the name of a key id if it is not already known. Two names with the same id can not be told apart
+         * on the wire, so that is treated as a bug rather than silently sharing the id
+         * @param id The id of the key
+         * @param name The name of the key
+         */
+        void intern(KeyId id, const char* name) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto existing = _names.find(id);
+            if (existing == _names.end()) {
+                _names[id] = new String(name);
+            } else {
+                assert(!strcmp(existing->second->c_str(), name));
+            }
+        }
+
+        /**
+         * Forgets the name of a key id. Called when the value under the key is removed
+         * @param id The id of the key
+         */
+        void forget(KeyId id) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto name = _names.find(id);
+            if (name == _names.end()) { return; }
+
+            delete name->second;
+            _names.erase(name);
+        }
+
+        /**
+         * Provides the name of a key id
+         * @param id The id of the key
+         * @return The name of the key, or nullptr if it is not interned. Copied, since the name may be forgotten at
+         *         any time. The caller owns it
+         */
+        String* lookup(KeyId id) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto name = _names.find(id);
+            return name == _names.end() ? nullptr : name->second->clone();
+        }
+
+        /** Provides the number of names that are interned */
+        size_t size() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _names.size();
+        }
+};
+
 /**
- * A key that contains a name and a home node
+ * A key that contains a name and a home node. Keys are identified by their id, so keys made from just an id
+ * compare equal to the named key they came from
  * Created by ng.h@husky.neu.edu and pazol.l@husky.neu.edu
  */
 class Key: public Object {
     public:
-        String* _name;
+
+        /** The number of home nodes that an id can address */
+        static const size_t MAX_NODES = 256;
+
+        /**
+         * Separates the parts of the names of keys that the store makes for itself, like the keys of chunks. Never
+         * used in the names of keys that applications make, so the two can be told apart
+         */
+        static const char SEPARATOR = '\x1f';
+
+        /** The name of the key. nullptr if the key was made from an id and its name has not been looked up yet */
+        mutable String* _name;
         size_t _node;
 
+        /** The id of the key */
+        KeyId _id;
+
         /**
          * Creates a new key
          * @param name The name of the key
@@ -21,21 +122,55 @@ class Key: public Object {
          * @param name The name of the key
          * @param node the home node of the key
          */
-        Key(String* name, size_t node = 0) {
-            _name = name;
-            _node = node;
-        }
+        Key(String* name, size_t node = 0) : _name(name), _node(node), _id(idFor(name->c_str(), node)) {}
+
+        /**
+         * Creates a key from its id. The name is looked up in the side table if it is needed
+         * @param id The id of the key
+         * @param name Optional. The name of the key, if it is known. Owns the string
+         */
+        explicit Key(KeyId id, String* name = nullptr) : _name(name), _node(id & (MAX_NODES - 1)), _id(id) {}
 
         ~Key() {
             delete _name;
         }
 
-        /** Provides the name of the key */
+        /**
+         * Hashes the name of a key with FNV-1a
+         * @param name The name to hash
+         * @return The hash of the name
+         */
+        static uint64_t hashName(const char* name) {
+            uint64_t hash = 14695981039346656037ULL;
+            for (const char* c = name; *c; c++) {
+                hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        /**
+         * Provides the id of the key with the given name and home node
+         * @param name The name of the key
+         * @param node The home node of the key. Must be less than MAX_NODES
+         */
+        static KeyId idFor(const char* name, size_t node) {
+            assert(node < MAX_NODES);
+            return (hashName(name) << 8) | node;
+        }
+
+        /** Provides the id of the key */
+        KeyId getId() const { return _id; }
+
+        /**
+         * Provides the name of the key. nullptr if the key was made from an id whose name is not interned. A name that
+         * is looked up is kept by the key, since the side table may forget it
+         */
         const char* getName() const {
-            return _name->c_str();
+            if (!_name) { _name = KeyNames::shared().lookup(_id); }
+            return _name ? _name->c_str() : nullptr;
         }
 
-        /** Provides the name of the key as a string */
+        /** Provides the name of the key as a string. nullptr if the key was made from an id and its name was not looked up */
         String* getNameAsString() const {
             return _name;
         }
@@ -46,21 +181,22 @@ class Key: public Object {
         }
 
         /** Compute the hash code (subclass responsibility) */
-        virtual size_t hash_me() { return _name->hash() + _node * 23891; };
+        virtual size_t hash_me() { return _id ^ (_id >> 8); };
 
-        /** Subclasses should redefine */
+        /**
+         * Keys are equal if their ids are. The names are compared too when both keys have one, so that two names whose
+         * ids collide do not share a value
+         */
         virtual bool equals(Object* other) {
             Key* givenKey = dynamic_cast<Key*>(other);
-            if (givenKey == nullptr) {
-                return false;
-            }
+            if (!givenKey || _id != givenKey->_id) { return false; }
 
-            return _name->equals(givenKey->_name) && _node == givenKey->getNode();
+            return !_name || !givenKey->_name || !strcmp(_name->c_str(), givenKey->_name->c_str());
         }
 
         /** Clones this key */
         Object *clone() override {
-            return new Key(_name->c_str(), _node);
+            return new Key(_id, _name ? new String(*_name) : nullptr);
         }
 
-};
\ No newline at end of file
+};
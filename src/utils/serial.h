@@ -43,7 +43,25 @@ class Serializer {
          * @param size the given object that is being serialized
          */
         void _expand(size_t size) {
-            size_t newCapacity = (_capacity + size) * 2;
+            _resize((_capacity + size) * 2);
+        }
+
+        /**
+         * Makes sure that the given number of bytes can be written without the buffer growing. Reserving the
+         * exact size up front means the buffer has no unused space if it is stolen
+         * @param size The number of bytes that will be written
+         */
+        void reserve(size_t size) {
+            if (_writtenBytes + size > _capacity) {
+                _resize(_writtenBytes + size);
+            }
+        }
+
+        /**
+         * Moves the written bytes into a new buffer
+         * @param newCapacity The capacity of the new buffer
+         */
+        void _resize(size_t newCapacity) {
             char* newBuffer = new char[newCapacity];
             memcpy(newBuffer, _buffer, sizeof(char) * _writtenBytes);
             delete[] _buffer;
@@ -68,6 +86,20 @@ class Serializer {
             return _buffer;
         }
 
+        /**
+         * Takes the buffer away from this serializer so that it does not have to be copied. The serializer is
+         * empty afterwards
+         * @return The buffer, allocated with new[]. The caller owns it
+         */
+        char* steal() {
+            char* buffer = _buffer;
+            _buffer = nullptr;
+            _capacity = 0;
+            _writtenBytes = 0;
+
+            return buffer;
+        }
+
         /**
          * Returns a copy of the buffer
          * @return The buffer
@@ -213,12 +245,13 @@ class Serializer {
         }
 
         /**
-         * Public write method that serializes a Key object
+         * Public write method that serializes a Key object. Only the id of the key is written, the name is
+         * interned in the side table of key names so it can still be found in this process
          * @param data an Key object
          */
         void write(Key& data) {
-            write((uint32_t)data.getNode());
-            write(data.getNameAsString());
+            if (data.getNameAsString()) { KeyNames::shared().intern(data.getId(), data.getName()); }
+            write((uint64_t)data.getId());
         }
 };
 
@@ -459,12 +492,7 @@ class Deserializer {
          * @return the Key object
          */
         Key* read_key() {
-            uint32_t node = read_uint32();
-            String* name = read_string();
-            Key* key = new Key(name->c_str(), node);
-            delete name;
-
-            return key;
+            return new Key((KeyId)read_uint64());
         }
 
         /** Provides the number of bytes that are left to be deserialized */
@@ -0,0 +1,115 @@
+#pragma once
+
+// Language: C++
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs tasks on a bounded number of threads. Submitting blocks once as many tasks are queued as there are threads,
+ * so a producer can not get arbitrarily far ahead of the work, and only a bounded number of tasks are ever in
+ * flight. Threads are started as they are needed
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class Workers {
+    public:
+
+        /** The maximum number of threads */
+        size_t _maxThreads;
+
+        /** The threads that have been started */
+        std::vector<std::thread> _threads;
+
+        /** The tasks that have not been started yet */
+        std::deque<std::function<void()>> _queue;
+
+        /** The number of tasks that have been submitted and have not finished */
+        size_t _pending = 0;
+
+        /** The number of threads that are waiting for a task */
+        size_t _idle = 0;
+
+        /** True once the threads should exit */
+        bool _stopping = false;
+
+        /** Mutex for everything above */
+        std::mutex _mutex;
+
+        /** Signalled when a task is queued or the threads should exit */
+        std::condition_variable _queued;
+
+        /** Signalled when a task is started or finished */
+        std::condition_variable _progressed;
+
+        /**
+         * Default constructor
+         * @param maxThreads The maximum number of tasks that run at the same time. At least 1
+         */
+        Workers(size_t maxThreads) : _maxThreads(maxThreads ? maxThreads : 1) {}
+
+        /** Waits for all of the submitted tasks and stops the threads */
+        ~Workers() {
+            wait();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+
+            _queued.notify_all();
+            for (std::thread& thread : _threads) {
+                thread.join();
+            }
+        }
+
+        /**
+         * Runs a task on one of the threads. Blocks while the queue is full
+         * @param task The task to run
+         */
+        void submit(std::function<void()> task) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _progressed.wait(lock, [&] { return _queue.size() < _maxThreads; });
+
+            _queue.push_back(std::move(task));
+            _pending++;
+
+            if (_queue.size() > _idle && _threads.size() < _maxThreads) {
+                _threads.emplace_back([this] { _work(); });
+            }
+
+            lock.unlock();
+            _queued.notify_one();
+        }
+
+        /** Blocks until every task that was submitted has finished */
+        void wait() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _progressed.wait(lock, [&] { return _pending == 0; });
+        }
+
+        /** Runs queued tasks until the threads should exit */
+        void _work() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _idle++;
+                _queued.wait(lock, [&] { return _stopping || !_queue.empty(); });
+                _idle--;
+
+                if (_queue.empty()) { return; }
+
+                std::function<void()> task = std::move(_queue.front());
+                _queue.pop_front();
+                _progressed.notify_all();
+
+                lock.unlock();
+                task();
+                lock.lock();
+
+                _pending--;
+                _progressed.notify_all();
+            }
+        }
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+// Language: C++
+
+#include <cmath>
+#include <cstdint>
+
+#include "serial.h"
+
+/**
+ * A summary of the values in one chunk of one column, which lets a scan rule out a chunk without reading it. Ints,
+ * bools and doubles are all summarized by their smallest and largest value, with false as 0 and true as 1. Strings
+ * are only summarized by how many of them are missing, so their bounds are left open
+ * Written by: pazol.l@husky.neu.edu and ng.h@husky.neu.edu
+ */
+class ZoneMap {
+    public:
+
+        /** The smallest value in the chunk */
+        double min = -HUGE_VAL;
+
+        /** The largest value in the chunk */
+        double max = HUGE_VAL;
+
+        /** The number of values in the chunk that are missing */
+        uint64_t nulls = 0;
+
+        /** The number of values in the chunk that are true. Only counted for bools */
+        uint64_t trues = 0;
+
+        /** Creates a zone map that rules nothing out, for chunks whose values are not known */
+        ZoneMap() {}
+
+        /** Provides a zone map that no value has been added to yet */
+        static ZoneMap empty() {
+            ZoneMap zoneMap;
+            zoneMap.min = HUGE_VAL;
+            zoneMap.max = -HUGE_VAL;
+            return zoneMap;
+        }
+
+        /**
+         * Widens the bounds to include a value
+         * @param value The value
+         */
+        void add(double value) {
+            if (value < min) { min = value; }
+            if (value > max) { max = value; }
+        }
+
+        /**
+         * Determines whether the chunk may contain a value in a range
+         * @param low The smallest value in the range
+         * @param high The largest value in the range
+         */
+        bool overlaps(double low, double high) const { return min <= high && max >= low; }
+
+        /** Writes the zone map out to a buffer */
+        void serialize(Serializer& serializer) {
+            serializer.write(min);
+            serializer.write(max);
+            serializer.write(nulls);
+            serializer.write(trues);
+        }
+
+        /** Reads the zone map from a buffer */
+        void deserialize(Deserializer& deserializer) {
+            min = deserializer.read_double();
+            max = deserializer.read_double();
+            nulls = deserializer.read_uint64();
+            trues = deserializer.read_uint64();
+        }
+};
@@ -270,33 +270,35 @@ class WordCount: public Application {
             Adder add(map);
             words->local_map(add);
             Summer cnt(map);
-            DataFrame::fromVisitor(mk_key(this_node()), &kv, "SI", &cnt);
+
+            // The counts stay on this node until the reduction reads them, rather than being spread over the cluster
+            DataFrame::fromVisitor(mk_key(this_node()), &kv, "SI", &cnt, PlacementHint::local());
             delete words;
         }
 
-        /** Merge the data frames of all nodes */
+        /** Merge the data frames of all nodes, in whatever order the nodes finish them */
         void reduce() {
             if (this_node() != 0) return;
             pln("Node 0: reducing counts...");
             SIMap map;
-            Key* own = mk_key(0);
-            DataFrame** dataframes = new DataFrame*[kv._byteStore.nodes()];
-            dataframes[0] = kv.get(*own);
-            merge(dataframes[0], map);
-            for (size_t i = 1; i < kv._byteStore.nodes(); ++i) { // merge other nodes
-                Key* ok = mk_key(i);
-                dataframes[i] = kv.waitAndGet(*ok);
-                merge(dataframes[i], map);
-                delete ok;
-            }
+
+            // The words in the map belong to the dataframes, so they are kept until the map is done
+            std::vector<DataFrame*> dataframes;
+            kv.gather(kbuf.orig_->getName(), kv._byteStore.nodes(), [&](Key& key, DataFrame* df) {
+                merge(df, map);
+                dataframes.push_back(df);
+            });
             wordCount = map.get_size();
             p("Different words: ").pln(wordCount);
-            delete own;
 
             for (size_t i = 0; i < kv._byteStore.nodes(); i++) {
                 delete dataframes[i];
+
+                // The partial counts are only needed for this reduction
+                Key* k = mk_key(i);
+                kv.remove(*k);
+                delete k;
             }
-            delete [] dataframes;
         }
 
         void merge(DataFrame* df, SIMap& m) {
@@ -3,6 +3,7 @@
 #include "utils.h"
 #include "../src/dataframe/dataframe.h"
 #include "../src/network/server.h"
+#include "../src/ea2/rebalancer.h"
 
 /* Start KVStore tests                                                */
 /*-----------------------------------------------------------------*/
@@ -358,10 +359,1358 @@ void testFromFile() {
     exit(0);
 }
 
+void testRemoteChunkCache() {
+    // Large enough to be stored in a chunk rather than inside of the description
+    const size_t count = 1024;
+    int first[count];
+    int second[count];
+    for (size_t i = 0; i < count; i++) {
+        first[i] = i + 1;
+        second[i] = i + 4;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        KVStore& writer = *stores[0];
+        KVStore& reader = *stores[1];
+        RemoteCache& cache = reader._byteStore._cache;
+
+        // The only chunk is homed on node 0, so node 1 has to go over the network for it
+        writer.setPlacement(new ModuloPlacement());
+        Key key("CACHED", 0);
+        DataFrame::fromArray(&key, &writer, count, first);
+
+        DataFrame* df = reader.get(key);
+        assert(df->get_int(0, 1) == 2);
+        delete df;
+        assert(cache.misses == 1 && cache.hits == 0);
+
+        df = reader.get(key);
+        assert(df->get_int(0, 2) == 3);
+        delete df;
+        assert(cache.hits == 1);
+
+        // Re-putting the key gives the chunk a new key, so the cached copy can not be used
+        DataFrame::fromArray(&key, &writer, count, second);
+
+        df = reader.get(key);
+        assert(df->get_int(0, 0) == 4);
+        delete df;
+        assert(cache.misses == 2);
+
+        cache.setCapacity(0);
+        assert(cache.size() == 0);
+        assert(cache.evictions == 2);
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testRemoveAndExpire() {
+    // Large enough to be stored in a chunk rather than inside of the description
+    const size_t count = 1024;
+    int values[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = i + 1;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("GONE", 1);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        DataFrame* df = stores[2]->get(key);
+        assert(df && df->get_int(0, 2) == 3);
+        delete df;
+
+        // Removing the dataframe removes its description and chunks everywhere, and the name of its key
+        Serializer named;
+        named.write(key);
+        assert(stores[0]->remove(key));
+        assert(!KeyNames::shared().lookup(key.getId()));
+        assert(!stores[2]->get(key));
+        assert(!stores[0]->remove(key));
+        assert(stores[0]->removePrefix("GONE") == 0);
+
+        // Putting the key again interns its name again, so that it is found by prefix
+        DataFrame::fromArray(&key, stores[0], count, values);
+        String* name = KeyNames::shared().lookup(key.getId());
+        assert(name && !strcmp(name->c_str(), "GONE"));
+        delete name;
+        assert(stores[0]->removePrefix("GONE") == 2);
+
+        // Every dataframe under a namespace can be dropped at once, along with their chunks
+        Key first("tmp-a", 0);
+        Key second("tmp-b", 2);
+        DataFrame::fromArray(&first, stores[1], count, values);
+        DataFrame::fromArray(&second, stores[1], count, values);
+        assert(stores[2]->removePrefix("tmp-") == 4);
+        assert(!stores[0]->get(first) && !stores[0]->get(second));
+
+        // Expired values can no longer be read and are eventually swept out of the store
+        Key expiring("SHORT", 2);
+        DataFrame::fromArray(&expiring, stores[0], count, values);
+        assert(stores[1]->expire(expiring, 50));
+        usleep(100000);
+        assert(!stores[0]->get(expiring));
+
+        sleep(2);
+        assert(stores[0]->removePrefix("SHORT") == 0);
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testReplicatedReads() {
+    // Large enough to be stored in a chunk rather than inside of the description
+    const size_t count = 1024;
+    int values[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = i + 1;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // The only chunk has copies on nodes 0 and 1
+        stores[0]->setPlacement(new ModuloPlacement());
+        stores[0]->setReplication(2);
+        Key key("REPL", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        // Node 1 reads its own copy
+        DataFrame* df = stores[1]->get(key);
+        assert(df->get_int(0, 1) == 2);
+        assert(stores[1]->_byteStore._cache.misses == 0);
+
+        DataframeDescription& desc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        Key* primary = desc.keyFor(0, 0, 0);
+        Key* replica = desc.keyFor(0, 0, 1);
+        assert(primary->getNode() == 0 && replica->getNode() == 1);
+        ByteArray* copy = stores[1]->_byteStore.get(*replica);
+        assert(copy);
+        delete copy;
+        delete df;
+
+        // Node 2 asks node 0 first. Node 0 lost its copy, so the read is hedged to node 1 once it takes
+        // longer than recent reads
+        KBStore& reader = stores[2]->_byteStore;
+        for (size_t i = 0; i < LatencyWindow::MIN_SAMPLES; i++) {
+            reader._latencies.record(1000);
+        }
+
+        stores[0]->_byteStore.remove(*primary);
+        df = stores[2]->get(key);
+        assert(df->get_int(0, 2) == 3);
+        delete df;
+        assert(reader.hedges == 1);
+
+        // Let the abandoned read to node 0 finish
+        stores[0]->_byteStore.put("", 1, *primary);
+        while (reader._racing) { std::this_thread::yield(); }
+        delete primary;
+        delete replica;
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testPutTakesOwnership() {
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        KBStore& store = stores[0]->_byteStore;
+
+        // A local put keeps the serializer's buffer instead of copying it
+        Serializer serializer;
+        serializer.reserve(sizeof(uint64_t));
+        serializer.write((uint64_t)42);
+        const char* buffer = serializer.getBuffer();
+
+        Key local("OWNED", 0);
+        store.put(serializer, local);
+        assert(serializer.getSize() == 0);
+
+        ByteArray* bytes = store.get(local);
+        assert(bytes->contents == buffer);
+        delete bytes;
+
+        // A remote put is stored straight out of the message the home node received
+        Serializer remoteSerializer;
+        remoteSerializer.write((uint64_t)7);
+
+        Key remote("OWNED", 1);
+        store.put(remoteSerializer, remote);
+        assert(remoteSerializer.getSize() == sizeof(uint64_t));
+
+        bytes = stores[1]->_byteStore.get(remote);
+        Deserializer deserializer(bytes->length, bytes->contents);
+        assert(deserializer.read_uint64() == 7);
+        delete bytes;
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testLockFreeReads() {
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        KBStore& store = stores[0]->_byteStore;
+        const size_t keys = 1000;
+
+        char name[32];
+        for (uint64_t i = 0; i < keys; i++) {
+            sprintf(name, "rcu-%zu", (size_t)i);
+            Key key(name, 0);
+            store.put((const char*)&i, sizeof(uint64_t), key);
+        }
+
+        // Readers never see a torn or mismatched value while a writer replaces and removes values
+        std::atomic<bool> done(false);
+        std::atomic<size_t> reads(0);
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < 4; r++) {
+            readers.push_back(std::thread([&] {
+                char readerName[32];
+                while (!done) {
+                    for (uint64_t i = 0; i < keys; i++) {
+                        sprintf(readerName, "rcu-%zu", (size_t)i);
+                        Key key(readerName, 0);
+
+                        ByteArray* bytes = store.get(key);
+                        if (bytes) {
+                            assert(bytes->length == sizeof(uint64_t) && *(uint64_t*)bytes->contents == i);
+                            delete bytes;
+                        }
+                        reads++;
+                    }
+                }
+            }));
+        }
+
+        for (size_t round = 0; round < 20; round++) {
+            for (uint64_t i = round % 2; i < keys; i += 2) {
+                sprintf(name, "rcu-%zu", (size_t)i);
+                Key key(name, 0);
+                if (round % 3 == 0) {
+                    store.remove(key);
+                } else {
+                    store.put((const char*)&i, sizeof(uint64_t), key);
+                }
+            }
+        }
+
+        done = true;
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
+
+        assert(reads >= keys * 4);
+        return true;
+    });
+
+    exit(0);
+}
+
+void testColdTier() {
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        const size_t elements = 4096;
+        Serializer serializer;
+        serializer.write((uint64_t)elements);
+        for (size_t i = 0; i < elements; i++) {
+            Element element;
+            element.ptr = nullptr;
+            element.i = (int)i;
+            serializer._write((const char*)&element, sizeof(Element));
+        }
+
+        for (size_t node = 0; node < 2; node++) {
+            stores[node]->_byteStore.setColdAfter(1);
+        }
+
+        Key local("COLD", 0);
+        Key remote("COLD", 1);
+        stores[0]->_byteStore.put(serializer.getBuffer(), serializer.getSize(), local);
+        stores[0]->_byteStore.put(serializer.getBuffer(), serializer.getSize(), remote);
+
+        // Both values go cold once the listening threads next look at them
+        for (size_t node = 0; node < 2; node++) {
+            ColdTierReport report = stores[node]->_byteStore.coldTierReport();
+            while (!report.coldValues) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                report = stores[node]->_byteStore.coldTierReport();
+            }
+
+            assert(report.coldOriginalBytes == serializer.getSize());
+            assert(report.savedBytes() > serializer.getSize() / 2);
+        }
+
+        // Reads decompress the values, locally and for other nodes
+        ByteArray* bytes = stores[0]->_byteStore.get(local);
+        assert(bytes->length == serializer.getSize() && !memcmp(bytes->contents, serializer.getBuffer(), bytes->length));
+        delete bytes;
+
+        bytes = stores[2]->_byteStore.waitAndGet(remote);
+        assert(bytes->length == serializer.getSize() && !memcmp(bytes->contents, serializer.getBuffer(), bytes->length));
+        delete bytes;
+
+        for (size_t node = 0; node < 2; node++) {
+            assert(stores[node]->_byteStore.coldTierReport().thaws == 1);
+        }
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testDeduplication() {
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        KBStore& store = stores[0]->_byteStore;
+        KBStore& remoteStore = stores[1]->_byteStore;
+
+        char body[4096];
+        for (size_t i = 0; i < sizeof(body); i++) {
+            body[i] = (char)(i * 7);
+        }
+
+        // Values with the same bytes on one node share a single body
+        Key first("SAME-A", 0);
+        Key second("SAME-B", 0);
+        store.put(body, sizeof(body), first);
+        store.put(body, sizeof(body), second);
+        assert(store._contents.deduplicated == 1);
+
+        ByteArray* a = store.get(first);
+        ByteArray* b = store.get(second);
+        assert(a->contents == b->contents);
+        delete a;
+        delete b;
+
+        // Removing one of them leaves the other intact
+        store.remove(first);
+        b = store.get(second);
+        assert(b->length == sizeof(body) && !memcmp(b->contents, body, sizeof(body)));
+
+        // A body whose fingerprint collides with a stored one keeps its own bytes
+        char other[sizeof(body)];
+        memset(other, 3, sizeof(other));
+        store._contents._contents[Fingerprint(other, sizeof(other))] = ContentTable::Content{b->_buffer, b->contents, b->length};
+        delete b;
+
+        Key colliding("SAME-OTHER", 0);
+        store.put(other, sizeof(other), colliding);
+        assert(store._contents.deduplicated == 1);
+        b = store.get(colliding);
+        assert(!memcmp(b->contents, other, sizeof(other)));
+        delete b;
+
+        // A body that was already sent to a node is not sent again
+        Key remoteFirst("SAME-A", 1);
+        Key remoteSecond("SAME-B", 1);
+        store.put(body, sizeof(body), remoteFirst);
+        store.put(body, sizeof(body), remoteSecond);
+        assert(store.skippedTransfers == 1);
+        assert(remoteStore._contents.deduplicated == 1);
+
+        b = remoteStore.get(remoteSecond);
+        assert(b->length == sizeof(body) && !memcmp(b->contents, body, sizeof(body)));
+        delete b;
+
+        // Once the home node has let go of the body, it is sent again
+        remoteStore.remove(remoteFirst);
+        remoteStore.remove(remoteSecond);
+        Epochs::shared().reclaim();
+
+        Key remoteThird("SAME-C", 1);
+        store.put(body, sizeof(body), remoteThird);
+        assert(store.skippedTransfers == 1);
+
+        b = remoteStore.get(remoteThird);
+        assert(b->length == sizeof(body) && !memcmp(b->contents, body, sizeof(body)));
+        delete b;
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testScan() {
+    int values[] = {1, 2, 3};
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // Partial results on every node, plus a key that only shares part of the prefix
+        for (size_t node = 0; node < 3; node++) {
+            Key key(StrBuff("part-").c(node).get(), node);
+            DataFrame::fromArray(&key, stores[node], 3, values);
+        }
+        Key other("partial", 1);
+        DataFrame::fromArray(&other, stores[1], 3, values);
+
+        // Keys are listed with their home nodes, and chunk keys are left out
+        std::vector<Key*> keys = stores[2]->scan("part-");
+        assert(keys.size() == 3);
+
+        bool found[3] = {false, false, false};
+        for (Key* key : keys) {
+            assert(!strncmp(key->getName(), "part-", 5));
+            assert(key->getName()[5] - '0' == (int)key->getNode());
+            found[key->getNode()] = true;
+            delete key;
+        }
+        assert(found[0] && found[1] && found[2]);
+
+        // Gathering hands over every dataframe under the prefix exactly once
+        size_t gathered = 0;
+        stores[0]->gather("part-", 3, [&](Key& key, DataFrame* df) {
+            assert(df->get_int(0, 2) == 3);
+            gathered++;
+            delete df;
+        });
+        assert(gathered == 3);
+
+        // Removed keys are no longer listed
+        Key removed("part-1", 1);
+        stores[0]->remove(removed);
+        keys = stores[0]->scan("part-");
+        assert(keys.size() == 2);
+        for (Key* key : keys) {
+            delete key;
+        }
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testVersionedPuts() {
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        KBStore& store = stores[0]->_byteStore;
+
+        for (size_t node = 0; node < 2; node++) {
+            Key key("CAS", node);
+
+            // Creating only works while there is no value
+            uint64_t first = store.putIfVersion("a", 1, key, 0);
+            assert(first != 0);
+            assert(store.putIfVersion("b", 1, key, 0) == 0);
+
+            // Replacing only works from the current version
+            uint64_t second = store.putIfVersion("c", 1, key, first);
+            assert(second > first);
+            assert(store.putIfVersion("d", 1, key, first) == 0);
+
+            ByteArray* bytes = store.get(key);
+            assert(bytes->version == second && bytes->contents[0] == 'c');
+            delete bytes;
+
+            // Only changes since a version that was already read are returned
+            assert(store.getIfNewer(key, second) == nullptr);
+            bytes = store.getIfNewer(key, first);
+            assert(bytes->version == second && bytes->contents[0] == 'c');
+            delete bytes;
+
+            uint64_t third = store.put("e", 1, key);
+            assert(third > second);
+            bytes = store.getIfNewer(key, second);
+            assert(bytes->version == third && bytes->contents[0] == 'e');
+            delete bytes;
+        }
+
+        return true;
+    });
+
+    exit(0);
+}
+
+void testParallelPut() {
+    const size_t count = Column::CHUNK_SIZE * 2 + 5;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // The chunks of one large dataframe are uploaded at the same time
+        Key big("PARALLEL-BIG", 0);
+        DataFrame::fromArray(&big, stores[0], count, values);
+
+        // Several threads can put through the same store
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                Key key(StrBuff("PARALLEL-").c(t).get(), 0);
+                DataFrame::fromArray(&key, stores[0], 3, values + t);
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        DataFrame* df = stores[1]->waitAndGet(big);
+        assert(df->nrows() == count);
+        assert(df->get_int(0, Column::CHUNK_SIZE - 1) == (int)Column::CHUNK_SIZE - 1);
+        assert(df->get_int(0, Column::CHUNK_SIZE) == (int)Column::CHUNK_SIZE);
+        assert(df->get_int(0, count - 1) == (int)count - 1);
+        delete df;
+
+        for (size_t t = 0; t < 4; t++) {
+            Key key(StrBuff("PARALLEL-").c(t).get(), 0);
+            df = stores[2]->waitAndGet(key);
+            assert(df->get_int(0, 0) == (int)t);
+            delete df;
+        }
+
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+/** Writes the numbers below a limit */
+class CountingWriter : public Writer {
+    public:
+        size_t _next = 0;
+        size_t _limit;
+
+        CountingWriter(size_t limit) : _limit(limit) {}
+
+        void visit(Row& r) override { r.set(0, (int)_next++); }
+
+        bool done() override { return _next == _limit; }
+};
+
+/** Counts the rows it visits */
+class CountingReader : public Reader {
+    public:
+        size_t _rows = 0;
+
+        bool visit(Row& r) override {
+            _rows++;
+            return true;
+        }
+};
+
+void testAdaptiveChunks() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // A dataframe far smaller than a chunk is still split so that every node gets some of it
+        Key known("ADAPTIVE-KNOWN", 0);
+        DataFrame::fromArray(&known, stores[0], count, values);
+
+        DataFrame* df = stores[1]->waitAndGet(known);
+        ChunkedColumn* column = dynamic_cast<ChunkedColumn*>(df->getColumn(0));
+        assert(column->_chunkRows == Column::chunkRowsFor(count, "I", stores.size()));
+        assert(column->_chunkCount == stores.size() * Column::CHUNKS_PER_NODE);
+        assert(df->get_int(0, column->_chunkRows) == (int)column->_chunkRows);
+        assert(df->get_int(0, count - 1) == (int)count - 1);
+        delete df;
+
+        // The chunk size is picked once all of the rows are known when they are not known up front
+        Key unknown("ADAPTIVE-UNKNOWN", 0);
+        CountingWriter writer(count / 2);
+        DataFrame::fromVisitor(&unknown, stores[0], "I", &writer);
+
+        size_t visited = 0;
+        size_t visitingNodes = 0;
+        for (KVStore* store : stores) {
+            df = store->waitAndGet(unknown);
+            column = dynamic_cast<ChunkedColumn*>(df->getColumn(0));
+            assert(column->_chunkRows == Column::chunkRowsFor(count / 2, "I", stores.size()));
+
+            CountingReader reader;
+            df->local_map(reader);
+            visited += reader._rows;
+            visitingNodes += reader._rows ? 1 : 0;
+            delete df;
+        }
+
+        // Every row is visited once, by more than one node
+        assert(visited == count / 2);
+        assert(visitingNodes > 1);
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+/** Sums the first column of the rows it visits */
+class SummingReader : public Reader {
+    public:
+        long _sum = 0;
+
+        bool visit(Row& r) override {
+            _sum += r.get_int(0);
+            return true;
+        }
+};
+
+void testReadAhead() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("READ-AHEAD", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        // A scan reads the chunks after the one it is on in the background and then uses them
+        stores[1]->_byteStore.setReadAhead(3);
+        DataFrame* df = stores[1]->waitAndGet(key);
+        SummingReader reader;
+        df->map(reader);
+        assert(reader._sum == (long)count * (count - 1) / 2);
+        delete df;
+
+        KBStore& kbstore = stores[1]->_byteStore;
+        assert(kbstore.readAheads > 0);
+        assert(kbstore.readAheadHits == kbstore.readAheads);
+        assert(kbstore.readAheadHitRate() == 1);
+
+        // Every scan on a node shares its read ahead threads
+        for (size_t i = 0; i < 4; i++) {
+            df = stores[1]->waitAndGet(key);
+            SummingReader again;
+            df->map(again);
+            assert(again._sum == reader._sum);
+            delete df;
+        }
+
+        assert(kbstore.readAheadWorkers._threads.size() <= KBStore::READ_AHEAD_THREADS);
+
+        // Reading single values does not read ahead
+        size_t readAheads = kbstore.readAheads;
+        df = stores[1]->waitAndGet(key);
+        assert(df->get_int(0, count - 1) == (int)count - 1);
+        assert(df->get_int(0, 7) == 7);
+        delete df;
+        assert(kbstore.readAheads == readAheads);
+
+        // Reading ahead can be turned off
+        stores[2]->_byteStore.setReadAhead(0);
+        df = stores[2]->waitAndGet(key);
+        SummingReader unaided;
+        df->map(unaided);
+        assert(unaided._sum == reader._sum);
+        assert(stores[2]->_byteStore.readAheads == 0);
+        delete df;
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+void testChunkBudget() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("BUDGET", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        // A budget of about two chunks is enough to scan the whole dataframe
+        ChunkBudget& budget = stores[1]->_byteStore.chunkBudget;
+        size_t chunkBytes = Column::chunkRowsFor(count, "I", stores.size()) * sizeof(Element);
+        budget.setCapacity(chunkBytes * 2 + chunkBytes / 2);
+
+        DataFrame* df = stores[1]->waitAndGet(key);
+        SummingReader reader;
+        df->map(reader);
+        assert(reader._sum == (long)count * (count - 1) / 2);
+        assert(budget.size() <= chunkBytes * 2 + chunkBytes / 2);
+        assert(budget.evictions > 0);
+        assert(budget.hits > 0);
+
+        // Evicted chunks are loaded again when they are read
+        size_t misses = budget.misses;
+        assert(df->get_int(0, 0) == 0);
+        assert(budget.misses == misses + 1);
+
+        delete df;
+        assert(budget.size() == 0);
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+/**
+ * Builds a local dataframe of consecutive ints
+ * @param first The first int
+ * @param count The number of ints
+ */
+DataFrame* consecutiveInts(int first, size_t count) {
+    Schema schema("I");
+    DataFrame* df = new DataFrame(schema);
+    Row row(schema);
+    for (size_t i = 0; i < count; i++) {
+        row.set(0, first + (int)i);
+        df->add_row(row);
+    }
+
+    return df;
+}
+
+void testAppend() {
+    const size_t count = 10000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("APPEND", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+        DataFrame* before = stores[2]->waitAndGet(key);
+        DataFrame* stale = stores[0]->waitAndGet(key);
+
+        // The partial last chunk is written again along with the new rows, and the full chunks are left alone
+        DataFrame* extra = consecutiveInts(count, 5000);
+        stores[1]->append(key, extra);
+        delete extra;
+
+        DataFrame* after = stores[2]->waitAndGet(key);
+        assert(after->nrows() == count + 5000);
+        SummingReader reader;
+        after->map(reader);
+        assert(reader._sum == (long)(count + 5000) * (count + 4999) / 2);
+
+        DataframeDescription& oldDesc = *dynamic_cast<ChunkedColumn*>(before->getColumn(0))->_description;
+        DataframeDescription& newDesc = *dynamic_cast<ChunkedColumn*>(after->getColumn(0))->_description;
+        assert(newDesc.segments.size() == 2);
+        assert(newDesc.generationOf(0) == oldDesc.generationOf(0));
+        assert(newDesc.generationOf(oldDesc.chunks - 1) != oldDesc.generationOf(oldDesc.chunks - 1));
+
+        // Readers of the old description still see the old rows
+        assert(before->nrows() == count);
+        assert(before->get_int(0, count - 1) == (int)count - 1);
+
+        // Once the replaced chunk is gone, they read it through the new description
+        for (size_t copy = 0; copy < oldDesc.replication; copy++) {
+            Key* replaced = oldDesc.keyFor(0, oldDesc.chunks - 1, copy);
+            stores[0]->_byteStore.remove(*replaced);
+            delete replaced;
+        }
+
+        assert(stale->nrows() == count);
+        assert(stale->get_int(0, count - 1) == (int)count - 1);
+        delete stale;
+        delete before;
+        delete after;
+
+        // Appends that race each other are both kept
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < 2; t++) {
+            threads.emplace_back([&, t] {
+                DataFrame* more = consecutiveInts(count + 5000 + t * 100, 100);
+                stores[t]->append(key, more);
+                delete more;
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        after = stores[2]->waitAndGet(key);
+        assert(after->nrows() == count + 5200);
+        SummingReader all;
+        after->map(all);
+        assert(all._sum == (long)(count + 5200) * (count + 5199) / 2);
+        delete after;
+
+        // Appending to a key with no dataframe puts one
+        Key fresh("APPEND-FRESH", 1);
+        extra = consecutiveInts(0, 10);
+        stores[0]->append(fresh, extra);
+        delete extra;
+        after = stores[1]->waitAndGet(fresh);
+        assert(after->nrows() == 10 && after->get_int(0, 9) == 9);
+        delete after;
+
+        // The first appends to a key that race each other are both kept
+        Key raced("APPEND-RACED", 2);
+        threads.clear();
+        for (size_t t = 0; t < 2; t++) {
+            threads.emplace_back([&, t] {
+                DataFrame* more = consecutiveInts(t * 100, 100);
+                stores[t]->append(raced, more);
+                delete more;
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        after = stores[2]->waitAndGet(raced);
+        assert(after->nrows() == 200);
+        SummingReader both;
+        after->map(both);
+        assert(both._sum == 200L * 199 / 2);
+        delete after;
+
+        // Putting a dataframe again expires the chunks of the one it replaces, but not its own
+        before = stores[2]->waitAndGet(key);
+        DataframeDescription& replacedDesc = *dynamic_cast<ChunkedColumn*>(before->getColumn(0))->_description;
+        DataFrame::fromArray(&key, stores[1], count, values);
+        after = stores[2]->waitAndGet(key);
+        DataframeDescription& putDesc = *dynamic_cast<ChunkedColumn*>(after->getColumn(0))->_description;
+        {
+            EpochGuard guard;
+            for (size_t chunk = 0; chunk < replacedDesc.chunks; chunk++) {
+                Key* chunkKey = replacedDesc.keyFor(0, chunk, 0);
+                assert(stores[chunkKey->getNode()]->_byteStore._index.get(*chunkKey)->expiresAt);
+                delete chunkKey;
+            }
+            for (size_t chunk = 0; chunk < putDesc.chunks; chunk++) {
+                Key* chunkKey = putDesc.keyFor(0, chunk, 0);
+                assert(!stores[chunkKey->getNode()]->_byteStore._index.get(*chunkKey)->expiresAt);
+                delete chunkKey;
+            }
+        }
+
+        assert(after->nrows() == count && after->get_int(0, count - 1) == (int)count - 1);
+        delete before;
+        delete after;
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+void testZoneMaps() {
+    const size_t count = 40000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("ZONES", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        // The column is sorted, so a narrow range only reads the chunk it falls in
+        DataFrame* df = stores[1]->waitAndGet(key);
+        DataframeDescription& desc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        double chunkRows = desc.chunkRows;
+        assert(desc.chunks > 2);
+        assert(desc.zoneMapOf(0, 1).min == chunkRows && desc.zoneMapOf(0, 1).max == 2 * chunkRows - 1);
+
+        KBStore& kbstore = stores[1]->_byteStore;
+        RangePredicate range(0, chunkRows + 10, chunkRows + 20);
+        SummingReader reader;
+        df->map(reader, range);
+        assert(reader._sum == 11 * (long)desc.chunkRows + 165);
+        assert(kbstore.filters <= 1);
+        assert(kbstore.readAheads == 0);
+
+        // A range that no chunk can hold reads nothing
+        RangePredicate none(0, -10, -1);
+        CountingReader counter;
+        size_t filters = kbstore.filters;
+        df->map(counter, none);
+        assert(counter._rows == 0);
+        assert(kbstore.filters == filters);
+        delete df;
+
+        // Bools are summarized by how many of them are true
+        Schema schema("IB");
+        DataFrame flags(schema);
+        Row row(schema);
+        for (int i = 0; i < 10; i++) {
+            row.set(0, i);
+            row.set(1, i == 3);
+            flags.add_row(row);
+        }
+
+        Key flagKey("FLAGS", 0);
+        stores[0]->put(&flags, flagKey);
+        df = stores[2]->waitAndGet(flagKey);
+        DataframeDescription& flagDesc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        assert(flagDesc.zoneMapOf(1, 0).trues == 1);
+        assert(flagDesc.zoneMapOf(1, 0).min == 0 && flagDesc.zoneMapOf(1, 0).max == 1);
+
+        RangePredicate set(1, 1, 1);
+        SummingReader flagged;
+        df->map(flagged, set);
+        assert(flagged._sum == 3);
+        delete df;
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+/** Writes rows of an int that cycles through 100 values and a string that cycles through 7 */
+class CyclingWriter : public Writer {
+    public:
+        size_t _next = 0;
+        size_t _limit;
+
+        CyclingWriter(size_t limit) : _limit(limit) {}
+
+        void visit(Row& r) override {
+            r.set(0, (int)(_next % 100));
+            r.set(1, StrBuff("s").c(_next % 7).get());
+            _next++;
+        }
+
+        bool done() override { return _next == _limit; }
+};
+
+/** Checks that every row it visits has the int and string it was written with, and that the rows come in order */
+class CyclingReader : public Reader {
+    public:
+        size_t _rows = 0;
+        long _last = -1;
+
+        bool visit(Row& r) override {
+            String* expected = StrBuff("s").c(r.get_idx() % 7).get();
+            assert(r.get_int(0) == (int)(r.get_idx() % 100));
+            assert(r.get_string(1)->equals(expected));
+            assert((long)r.get_idx() > _last);
+            delete expected;
+            _last = r.get_idx();
+            _rows++;
+            return true;
+        }
+};
+
+void testFilterPushdown() {
+    const size_t count = 40000;
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("PUSHDOWN", 0);
+        CyclingWriter writer(count);
+        DataFrame::fromVisitor(&key, stores[0], "IS", &writer);
+
+        // Every chunk holds every value, so no chunk is ruled out, but only the matching rows are sent
+        DataFrame* df = stores[1]->waitAndGet(key);
+        KBStore& kbstore = stores[1]->_byteStore;
+        RangePredicate five = RangePredicate::equalTo(0, 5);
+        CyclingReader reader;
+        df->map(reader, five);
+        assert(reader._rows == count / 100);
+        assert(kbstore.chunkBudget.misses == 0);
+        assert(kbstore.filters > 0);
+        assert(kbstore.filteredBytes * 20 < count * sizeof(Element));
+
+        // Comparisons are ranges with open ends
+        RangePredicate low = RangePredicate::lessThan(0, 2);
+        CyclingReader lowReader;
+        df->map(lowReader, low);
+        assert(lowReader._rows == count / 50);
+
+        StringEqualsPredicate three(1, new String("s3"));
+        CyclingReader threeReader;
+        df->map(threeReader, three);
+        assert(threeReader._rows == count / 7 + (count % 7 > 3 ? 1 : 0));
+        assert(kbstore.chunkBudget.misses == 0);
+
+        // The chunks whose home copy is on a node are filtered there
+        size_t visited = 0;
+        for (KVStore* store : stores) {
+            DataFrame* local = store->waitAndGet(key);
+            CyclingReader localReader;
+            local->local_map(localReader, five);
+            visited += localReader._rows;
+            delete local;
+        }
+
+        assert(visited == count / 100);
+
+        // A predicate of a type that a node does not know is not evaluated there, and the chunk is filtered by the caller
+        DataframeDescription& desc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        size_t chunk = 0;
+        while (desc.nodeOf(chunk, 0) != 0) { chunk++; }
+
+        Serializer request;
+        request.write(desc.name);
+        request.write(desc.generationOf(chunk));
+        request.write((uint64_t)chunk);
+        request.write(desc.chunkRows);
+        request.write(desc.schema);
+        request.write((uint8_t)(STRING_EQUALS_PREDICATE + 1));
+        request.write((uint64_t)0);
+
+        Deserializer requestReader(request.getSize(), request.getBuffer());
+        Serializer reply;
+        DataFrame::_filterChunk(stores[0]->_byteStore, requestReader, reply);
+        Deserializer replyReader(reply.getSize(), reply.getBuffer());
+        assert(replyReader.read_uint64() == DataFrame::FILTER_MISSED);
+
+        delete df;
+        return true;
+    });
+
+    exit(0);
+}
+
+/** Sums the ints above a threshold on every node */
+class DistributedSum : public DistributedReader {
+    public:
+        int _above;
+        long _sum = 0;
+        size_t _rows = 0;
+
+        DistributedSum(int above) : _above(above) {}
+
+        bool visit(Row& r) override {
+            if (r.get_int(0) > _above) { _sum += r.get_int(0); }
+            _rows++;
+            return true;
+        }
+
+        void serializeArgs(Serializer& serializer) override { serializer.write((int32_t)_above); }
+
+        void serializeResult(Serializer& serializer) override {
+            serializer.write((int64_t)_sum);
+            serializer.write((uint64_t)_rows);
+        }
+
+        void join(Deserializer& result) override {
+            _sum += result.read_int64();
+            _rows += result.read_uint64();
+        }
+};
+
+void testDistributedMap() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    DistributedReader::registerType("sum", [](Deserializer& args) { return new DistributedSum(args.read_int32()); });
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        Key key("DISTRIBUTED", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        // Every node reads its own chunks, so the caller reads none of the others
+        DataFrame* df = stores[1]->waitAndGet(key);
+        DistributedSum sum(count / 2);
+        MapTimings timings = df->distributed_map("sum", sum);
+        assert(sum._rows == count);
+        assert(sum._sum == (long)count * (count - 1) / 2 - (long)(count / 2) * (count / 2 + 1) / 2);
+        assert(timings.micros.size() == 3);
+        assert(timings.slowest() < 3);
+
+        DataframeDescription& desc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        size_t localChunks = 0;
+        for (size_t chunk = 0; chunk < desc.chunks; chunk++) {
+            localChunks += desc.nodeOf(chunk, 0) == 1 ? 1 : 0;
+        }
+
+        KBStore& kbstore = stores[1]->_byteStore;
+        assert(kbstore.chunkBudget.misses + kbstore.readAheads == localChunks);
+
+        // A type that is not registered is read by the caller instead
+        DistributedSum unregistered(-1);
+        df->distributed_map("unregistered", unregistered);
+        assert(unregistered._rows == count);
+        assert(unregistered._sum == (long)count * (count - 1) / 2);
+        delete df;
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+void testInlineDataframes() {
+    int values[] = {1, 2, 3};
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // A small dataframe is a single value, its description
+        Key key("SMALL", 1);
+        DataFrame::fromArray(&key, stores[0], 3, values);
+
+        size_t stored = 0;
+        for (KVStore* store : stores) {
+            store->_byteStore._index.forEach([&](Key* k, ByteArray* value) {
+                stored += strncmp(k->getName(), "SMALL", 5) == 0 ? 1 : 0;
+            });
+        }
+        assert(stored == 1);
+
+        DataFrame* df = stores[2]->get(key);
+        assert(df->nrows() == 3 && df->get_int(0, 2) == 3);
+        assert(dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description->isInline());
+        assert(stores[2]->_byteStore._cache.misses == 0);
+
+        // Only the node the dataframe is stored on visits its rows in a local map
+        long sum = 0;
+        for (KVStore* store : stores) {
+            DataFrame* local = store->get(key);
+            SummingReader reader;
+            local->local_map(reader);
+            sum += reader._sum;
+            delete local;
+        }
+        assert(sum == 6);
+        delete df;
+
+        // Appending rewrites the whole dataframe, which is split into chunks once it is no longer small
+        DataFrame* extra = consecutiveInts(4, 2000);
+        stores[2]->append(key, extra);
+        delete extra;
+
+        df = stores[0]->get(key);
+        assert(df->nrows() == 2003 && df->get_int(0, 2002) == 2003);
+        assert(!dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description->isInline());
+        delete df;
+
+        assert(stores[1]->remove(key));
+        assert(!stores[0]->get(key));
+        return true;
+    });
+
+    exit(0);
+}
+
+void testCombinedGet() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // Chunks 0 and 3 of the 6 are on node 0, along with the description
+        stores[0]->setPlacement(new ModuloPlacement());
+        Key key("COMBINED", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+
+        KBStore& reader = stores[1]->_byteStore;
+        reader.setReadAhead(0);
+
+        // The first chunk comes back with the description, so the first row is read without another round trip
+        DataFrame* df = stores[1]->get(key, KVStore::Prefetch(1));
+        assert(df->get_int(0, 0) == 0);
+        assert(reader.chunkBudget.misses == 0 && reader._cache.misses == 0);
+        assert(df->get_int(0, 30000) == 30000);
+        assert(reader.chunkBudget.misses == 1);
+
+        // The description knows its version, so that chunks it no longer has are read through a newer one
+        uint64_t version = dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description->version;
+        assert(version && version == stores[0]->_byteStore._versionLocal(key));
+        delete df;
+
+        // Every chunk of a column that is on the node comes back with it, and the others are fetched as usual
+        df = stores[1]->get(key, KVStore::Prefetch(0, {0}));
+        assert(df->get_int(0, 5) == 5 && df->get_int(0, 30005) == 30005);
+        assert(reader.chunkBudget.misses == 1);
+        assert(df->get_int(0, 10000) == 10000);
+        assert(reader.chunkBudget.misses == 2);
+        delete df;
+
+        Key missing("NOT-COMBINED", 2);
+        assert(!stores[1]->get(missing, KVStore::Prefetch(1)));
+
+        // A small dataframe is all in its description
+        int small[] = {7, 8, 9};
+        Key smallKey("COMBINED-SMALL", 2);
+        DataFrame::fromArray(&smallKey, stores[0], 3, small);
+        df = stores[1]->get(smallKey, KVStore::Prefetch(1));
+        assert(df->nrows() == 3 && df->get_int(0, 2) == 9);
+        delete df;
+
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+void testRebalance() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // 6 chunks on 3 nodes. Node 0 places them again since it has the description
+        stores[0]->setPlacement(new ModuloPlacement());
+        Key key("REBALANCE", 0);
+        DataFrame::fromArray(&key, stores[0], count, values);
+        DataFrame* before = stores[1]->waitAndGet(key);
+        DataFrame* stale = stores[2]->waitAndGet(key);
+        DataframeDescription& oldDesc = *dynamic_cast<ChunkedColumn*>(stale->getColumn(0))->_description;
+
+        // Chunks that were homed by a hint are left where they are
+        Key pinned("REBALANCE-LOCAL", 0);
+        DataFrame::fromArray(&pinned, stores[1], count, values, PlacementHint::local());
+
+        Rebalancer& rebalancer = *stores[0]->_rebalancer;
+        size_t passes = rebalancer.passes;
+        stores.push_back(new KVStore(inet_addr("127.0.0.1"), 25568, inet_addr("127.0.0.1"), SERVER_PORT));
+        while (rebalancer.passes == passes) { usleep(10000); }
+
+        // Chunks 3, 4 and 5 moved, and the new node reads its chunk in a local map
+        assert(rebalancer.movedChunks == 3);
+        DataFrame* after = stores[3]->get(key);
+        DataframeDescription& desc = *dynamic_cast<ChunkedColumn*>(after->getColumn(0))->_description;
+        for (size_t chunk = 0; chunk < desc.chunks; chunk++) {
+            assert(desc.nodeOf(chunk, 0) == chunk % 4);
+        }
+
+        long sum = 0;
+        for (KVStore* store : stores) {
+            DataFrame* df = store->get(key);
+            SummingReader reader;
+            df->local_map(reader);
+            sum += reader._sum;
+            delete df;
+        }
+        assert(sum == (long)count * (count - 1) / 2);
+
+        DataFrame* pinnedDf = stores[3]->get(pinned);
+        DataframeDescription& pinnedDesc = *dynamic_cast<ChunkedColumn*>(pinnedDf->getColumn(0))->_description;
+        for (size_t chunk = 0; chunk < pinnedDesc.chunks; chunk++) {
+            assert(pinnedDesc.nodeOf(chunk, 0) == 1);
+        }
+        delete pinnedDf;
+
+        SummingReader newNode;
+        after->local_map(newNode);
+        assert(newNode._sum == (long)10000 * (30000 + 39999) / 2);
+        delete after;
+
+        // Readers that hold the old description still read the old copies
+        SummingReader old;
+        before->map(old);
+        assert(old._sum == (long)count * (count - 1) / 2);
+        delete before;
+
+        // Once the copies that moved are gone, readers that hold the old description read the new one
+        for (size_t chunk = 3; chunk < oldDesc.chunks; chunk++) {
+            for (size_t copy = 0; copy < oldDesc.replication; copy++) {
+                Key* moved = oldDesc.keyFor(0, chunk, copy);
+                stores[0]->_byteStore.remove(*moved);
+                delete moved;
+            }
+        }
+
+        SummingReader recovered;
+        stale->map(recovered);
+        assert(recovered._sum == (long)count * (count - 1) / 2);
+        delete stale;
+
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
+void testPlacementHints() {
+    const size_t count = 60000;
+    int* values = new int[count];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = (int)i;
+    }
+
+    storeOperation([&](std::vector<KVStore*>& stores) -> bool {
+        // A node keeps what it builds, wherever the description is
+        Key local("HINT-LOCAL", 0);
+        DataFrame::fromArray(&local, stores[1], count, values, PlacementHint::local());
+
+        DataFrame* df = stores[1]->waitAndGet(local);
+        DataframeDescription& localDesc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        assert(localDesc.chunks > 1 && localDesc.pinned);
+        for (size_t chunk = 0; chunk < localDesc.chunks; chunk++) {
+            assert(localDesc.nodeOf(chunk, 0) == 1);
+        }
+
+        CountingReader rows;
+        df->local_map(rows);
+        assert(rows._rows == count);
+        delete df;
+
+        DataFrame* built = consecutiveInts(0, 20000);
+        Key put("HINT-PUT", 0);
+        stores[2]->put(built, put, PlacementHint::local());
+        delete built;
+
+        df = stores[0]->get(put);
+        DataframeDescription& putDesc = *dynamic_cast<ChunkedColumn*>(df->getColumn(0))->_description;
+        for (size_t chunk = 0; chunk < putDesc.chunks; chunk++) {
+            assert(putDesc.nodeOf(chunk, 0) == 2);
+        }
+        delete df;
+
+        // The rows of a dataframe are homed with the same rows of another one
+        stores[0]->setPlacement(new ModuloPlacement());
+        Key base("HINT-BASE", 0);
+        DataFrame::fromArray(&base, stores[0], count, values);
+
+        Key with("HINT-WITH", 2);
+        DataFrame::fromArray(&with, stores[2], count, values, PlacementHint::colocatedWith(base));
+
+        DataFrame* baseDf = stores[1]->get(base);
+        DataFrame* withDf = stores[1]->get(with);
+        DataframeDescription& baseDesc = *dynamic_cast<ChunkedColumn*>(baseDf->getColumn(0))->_description;
+        DataframeDescription& withDesc = *dynamic_cast<ChunkedColumn*>(withDf->getColumn(0))->_description;
+        assert(withDesc.chunks == baseDesc.chunks);
+        for (size_t chunk = 0; chunk < withDesc.chunks; chunk++) {
+            assert(withDesc.nodeOf(chunk, 0) == baseDesc.nodeOf(chunk, 0));
+        }
+        assert(withDf->get_int(0, count - 1) == (int)count - 1);
+        delete baseDf;
+        delete withDf;
+
+        return true;
+    });
+
+    delete[] values;
+    exit(0);
+}
+
 TEST(W3, testKVStoreMethods) { ASSERT_EXIT_ZERO(testKVStoreMethods) }
 TEST(W3, testMultipleKVPut) { ASSERT_EXIT_ZERO(testMultipleKVPut) }
 TEST(W3, testMultipleKVPutDifferentNodes) { ASSERT_EXIT_ZERO(testMultipleKVPutDifferentNodes) }
 TEST(W3, testStoreDoesntDeadlock) { ASSERT_EXIT_ZERO(testStoreDoesntDeadlock) }
 TEST(W3, testFromArray) { ASSERT_EXIT_ZERO(testFromArray) }
 TEST(W3, testFromScalar) { ASSERT_EXIT_ZERO(testFromScalar) }
-TEST(W3, testFromFile) { ASSERT_EXIT_ZERO(testFromFile) }
\ No newline at end of file
+TEST(W3, testFromFile) { ASSERT_EXIT_ZERO(testFromFile) }
+TEST(W3, testRemoteChunkCache) { ASSERT_EXIT_ZERO(testRemoteChunkCache) }
+TEST(W3, testRemoveAndExpire) { ASSERT_EXIT_ZERO(testRemoveAndExpire) }
+TEST(W3, testReplicatedReads) { ASSERT_EXIT_ZERO(testReplicatedReads) }
+TEST(W3, testPutTakesOwnership) { ASSERT_EXIT_ZERO(testPutTakesOwnership) }
+TEST(W3, testLockFreeReads) { ASSERT_EXIT_ZERO(testLockFreeReads) }
+TEST(W3, testColdTier) { ASSERT_EXIT_ZERO(testColdTier) }
+TEST(W3, testDeduplication) { ASSERT_EXIT_ZERO(testDeduplication) }
+TEST(W3, testScan) { ASSERT_EXIT_ZERO(testScan) }
+TEST(W3, testVersionedPuts) { ASSERT_EXIT_ZERO(testVersionedPuts) }
+TEST(W3, testParallelPut) { ASSERT_EXIT_ZERO(testParallelPut) }
+TEST(W3, testAdaptiveChunks) { ASSERT_EXIT_ZERO(testAdaptiveChunks) }
+TEST(W3, testReadAhead) { ASSERT_EXIT_ZERO(testReadAhead) }
+TEST(W3, testChunkBudget) { ASSERT_EXIT_ZERO(testChunkBudget) }
+TEST(W3, testAppend) { ASSERT_EXIT_ZERO(testAppend) }
+TEST(W3, testZoneMaps) { ASSERT_EXIT_ZERO(testZoneMaps) }
+TEST(W3, testFilterPushdown) { ASSERT_EXIT_ZERO(testFilterPushdown) }
+TEST(W3, testDistributedMap) { ASSERT_EXIT_ZERO(testDistributedMap) }
+TEST(W3, testInlineDataframes) { ASSERT_EXIT_ZERO(testInlineDataframes) }
+TEST(W3, testCombinedGet) { ASSERT_EXIT_ZERO(testCombinedGet) }
+TEST(W3, testRebalance) { ASSERT_EXIT_ZERO(testRebalance) }
+TEST(W3, testPlacementHints) { ASSERT_EXIT_ZERO(testPlacementHints) }
@@ -138,6 +138,37 @@ void test6() {
     exit(0);
 }
 
+/**
+ * test cases for remove()
+ * removed keys are no longer found, the other keys are unaffected and the removed entry is handed back
+ */
+void test7() {
+    Map* h1 = new Map();
+    String * key_1 = new String("A");
+    String * val_1 = new String("1");
+    String * key_2 = new String("B");
+    String * val_2 = new String("2");
+    h1->put(key_1, val_1);
+    h1->put(key_2, val_2);
+
+    Entry* removed = h1->remove(key_1);
+    GT_TRUE(removed != nullptr);
+    GT_TRUE(removed->value == val_1);
+    GT_TRUE(h1->get_size() == 1);
+    GT_FALSE(h1->contains_key(key_1));
+    GT_TRUE(h1->get(key_2)->equals(val_2));
+    GT_TRUE(h1->remove(key_1) == nullptr);
+
+    delete removed;
+    delete key_1;
+    delete key_2;
+    delete val_1;
+    delete val_2;
+    delete h1;
+
+    exit(0);
+}
+
 static const int _stressTestVal = 10000;
 
 void mapStressTest() {
@@ -182,4 +213,5 @@ TEST(W5, test3) { ASSERT_EXIT_ZERO(test3) }
 TEST(W5, test4) { ASSERT_EXIT_ZERO(test4) }
 TEST(W5, test5) { ASSERT_EXIT_ZERO(test5) }
 TEST(W5, test6) { ASSERT_EXIT_ZERO(test6) }
+TEST(W5, test7) { ASSERT_EXIT_ZERO(test7) }
 TEST(W5, mapStressTest) { ASSERT_EXIT_ZERO(mapStressTest) }
\ No newline at end of file
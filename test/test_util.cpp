@@ -2,28 +2,41 @@
 
 #include "utils.h"
 #include "../src/ea2/dataframe_description.h"
+#include "../src/ea2/placement.h"
+#include "../src/utils/codec.h"
+#include "../src/utils/workers.h"
 
 /* Start util tests                                                */
 /*-----------------------------------------------------------------*/
 
-void testColumnDescription() {
-    Key** keys = new Key*[2];
-    keys[0] = new Key("HELLO", 21);
-    keys[1] = new Key("BYE", 11);
+void testChunkKeys() {
+    const char _schema[3] = {INT, STRING, '\0'};
+    DataframeDescription desc(new String(_schema), new String("HELLO"), 7, 2020, 1000, 2);
 
-    Serializer s;
-    ColumnDescription(keys, 2, 25, INT).serialize(s);
+    size_t first[2] = {21, 11};
+    size_t second[2] = {0, 5};
+    desc.addChunk(first);
+    desc.addChunk(second);
 
-    Deserializer deserializer(s.getSize(), s.getBuffer());
-    ColumnDescription read;
-    read.deserialize(deserializer);
+    // Every copy of every chunk of every column has its own key on the node the copy is stored on
+    Key* key = desc.keyFor(1, 0, 1);
+    Key* expected = DataframeDescription::chunkKey("HELLO", 7, 1, 0, 11);
+    GT_TRUE(key->equals(expected));
+    GT_TRUE(key->getNode() == 11);
+    GT_TRUE(!strncmp(key->getName(), "HELLO\x1f", 6));
+    delete key;
+    delete expected;
 
-    GT_TRUE(read.type == INT);
-    GT_TRUE(read.chunks == 2);
-    GT_TRUE(!strcmp(read.keys[0]->getName(), "HELLO"));
-    GT_TRUE(!strcmp(read.keys[1]->getName(), "BYE"));
-    GT_TRUE(read.keys[0]->getNode() == 21);
-    GT_TRUE(read.keys[1]->getNode() == 11);
+    key = desc.keyFor(0, 1, 0);
+    GT_TRUE(key->getNode() == 0);
+    delete key;
+
+    // Another put of the same dataframe never reuses a key
+    Key* a = DataframeDescription::chunkKey("HELLO", 7, 0, 0, 0);
+    Key* b = DataframeDescription::chunkKey("HELLO", 8, 0, 0, 0);
+    GT_TRUE(!a->equals(b));
+    delete a;
+    delete b;
 
     exit(0);
 }
@@ -33,45 +46,243 @@ void testDataframeDescriptions() {
     const char _schema[3] = {INT, STRING, '\0'};
     String* schema = new String(_schema);
 
-    Key** kA = new Key*[2];
-    kA[0] = new Key("HELLO", 21);
-    kA[1] = new Key("BYE", 11);
-
-    Key** kB = new Key*[2];
-    kB[0] = new Key("HOUSE", 0);
-    kB[1] = new Key("BRICK", 5);
-
-    ColumnDescription** descriptions = new ColumnDescription*[2];
-    descriptions[0] = new ColumnDescription(kA, 2, 2020, INT);
-    descriptions[1] = new ColumnDescription(kB, 2, 97, STRING);
+    DataframeDescription desc(schema->clone(), new String("HELLO"), 7, 2020, 1000, 2);
+    size_t first[2] = {21, 11};
+    size_t second[2] = {0, 5};
+    ZoneMap zoneMaps[2];
+    zoneMaps[0].min = -3;
+    zoneMaps[0].max = 12;
+    zoneMaps[1].nulls = 4;
+    desc.addChunk(first, zoneMaps);
+    desc.addChunk(second);
 
     Serializer serializer;
-    DataframeDescription(schema->clone(), 2, descriptions).serialize(serializer);
+    desc.serialize(serializer);
 
     Deserializer deserializer(serializer.getSize(), serializer.getBuffer());
     DataframeDescription read;
     read.deserialize(deserializer);
 
     GT_TRUE(read.schema->equals(schema));
+    GT_TRUE(!strcmp(read.name->c_str(), "HELLO"));
+    GT_TRUE(read.generationOf(1) == 7);
+    GT_TRUE(read.rows == 2020);
+    GT_TRUE(read.chunkRows == 1000);
+    GT_TRUE(read.chunks == 2);
+    GT_TRUE(read.replication == 2);
+    GT_TRUE(read.columns() == 2);
+    GT_TRUE(read.typeOf(0) == INT);
+    GT_TRUE(read.typeOf(1) == STRING);
+    GT_TRUE(read.nodeOf(0, 0) == 21);
+    GT_TRUE(read.nodeOf(0, 1) == 11);
+    GT_TRUE(read.nodeOf(1, 0) == 0);
+    GT_TRUE(read.nodeOf(1, 1) == 5);
+    GT_TRUE(read.zoneMapOf(0, 0).min == -3 && read.zoneMapOf(0, 0).max == 12);
+    GT_TRUE(read.zoneMapOf(1, 0).nulls == 0 && read.zoneMapOf(1, 0).overlaps(13, 20));
+    GT_TRUE(!read.zoneMapOf(0, 0).overlaps(13, 20));
+    GT_TRUE(read.zoneMapOf(0, 1).overlaps(13, 20));
 
-    GT_TRUE(read.columns[0]->type == INT);
-    GT_TRUE(read.columns[0]->chunks == 2);
-    GT_TRUE(!strcmp(read.columns[0]->keys[0]->getName(), "HELLO"));
-    GT_TRUE(!strcmp(read.columns[0]->keys[1]->getName(), "BYE"));
-    GT_TRUE(read.columns[0]->keys[0]->getNode() == 21);
-    GT_TRUE(read.columns[0]->keys[1]->getNode() == 11);
+    // A description grows by a byte per copy of a chunk and a zone map per numeric column of a chunk
+    DataframeDescription large(schema->clone(), new String("HELLO"), 7, 10000 * 1000, 1000, 2);
+    for (size_t i = 0; i < 10000; i++) {
+        large.addChunk(first);
+    }
 
-    GT_TRUE(read.columns[1]->type == STRING);
-    GT_TRUE(read.columns[1]->chunks == 2);
-    GT_TRUE(!strcmp(read.columns[1]->keys[0]->getName(), "HOUSE"));
-    GT_TRUE(!strcmp(read.columns[1]->keys[1]->getName(), "BRICK"));
-    GT_TRUE(read.columns[1]->keys[0]->getNode() == 0);
-    GT_TRUE(read.columns[1]->keys[1]->getNode() == 5);
+    Serializer largeSerializer;
+    large.serialize(largeSerializer);
+    GT_TRUE(largeSerializer.getSize() - serializer.getSize() == (10000 - 2) * (2 + 4 * sizeof(uint64_t)));
 
     delete schema;
 
     exit(0);
 }
 
-TEST(W2, testColumnDescription) { ASSERT_EXIT_ZERO(testColumnDescription) }
-TEST(W2, testDataframeDescriptions) { ASSERT_EXIT_ZERO(testDataframeDescriptions) }
\ No newline at end of file
+void testConsistentHashPlacementIsBalanced() {
+    ConsistentHashPlacement placement;
+    const size_t nodes = 3;
+    const size_t dataframes = 200;
+    const size_t chunks = 300;
+    size_t counts[nodes] = {0, 0, 0};
+
+    char name[32];
+    for (size_t df = 0; df < dataframes; df++) {
+        sprintf(name, "df%zu", df);
+        Key key(name);
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            counts[placement.nodeFor(key, chunk, nodes)]++;
+        }
+    }
+
+    double mean = (double)(dataframes * chunks) / nodes;
+    for (size_t node = 0; node < nodes; node++) {
+        GT_TRUE(counts[node] > mean * 0.95 && counts[node] < mean * 1.05);
+    }
+
+    exit(0);
+}
+
+void testConsistentHashPlacementMovesLittle() {
+    ConsistentHashPlacement placement;
+    Key key("commits");
+
+    size_t moved = 0;
+    const size_t chunks = 10000;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        size_t before = placement.nodeFor(key, chunk, 3);
+        size_t after = placement.nodeFor(key, chunk, 4);
+
+        // Chunks only ever move to the new node
+        if (before != after) {
+            GT_TRUE(after == 3);
+            moved++;
+        }
+    }
+
+    // About a quarter of the chunks should move to the fourth node
+    GT_TRUE(moved > chunks / 5 && moved < chunks * 3 / 10);
+
+    exit(0);
+}
+
+void testConsistentHashPlacementReplicas() {
+    ConsistentHashPlacement placement;
+    Key key("commits");
+
+    size_t nodes[3];
+    for (size_t chunk = 0; chunk < 1000; chunk++) {
+        placement.nodesFor(key, chunk, 4, 3, nodes);
+
+        // The home node comes first and every copy is on a different node
+        GT_TRUE(nodes[0] == placement.nodeFor(key, chunk, 4));
+        GT_TRUE(nodes[0] != nodes[1] && nodes[0] != nodes[2] && nodes[1] != nodes[2]);
+    }
+
+    exit(0);
+}
+
+void testKeyIds() {
+    Key named("chunk-0-7", 2);
+    Key sameName("chunk-0-7", 2);
+    Key otherNode("chunk-0-7", 1);
+
+    GT_TRUE(named.getId() == sameName.getId());
+    GT_TRUE(named.equals(&sameName));
+    GT_TRUE(!named.equals(&otherNode));
+
+    // Keys only go over the wire as their 8 byte id
+    Serializer s;
+    s.write(named);
+    GT_TRUE(s.getSize() == sizeof(KeyId));
+
+    Deserializer deserializer(s.getSize(), s.getBuffer());
+    Key* read = deserializer.read_key();
+    GT_TRUE(read->getNode() == 2);
+    GT_TRUE(read->equals(&named));
+    GT_TRUE(read->hash_me() == named.hash_me());
+
+    // The name is found in the side table since it was serialized by this process
+    GT_TRUE(!strcmp(read->getName(), "chunk-0-7"));
+    GT_TRUE(Key(Key::idFor("never-serialized", 0)).getName() == nullptr);
+
+    // A forgotten name is no longer found, but keys that already looked it up keep it
+    KeyNames::shared().forget(named.getId());
+    Key forgotten(named.getId());
+    GT_TRUE(forgotten.getName() == nullptr);
+    GT_TRUE(!strcmp(read->getName(), "chunk-0-7"));
+
+    // Names whose ids collide are still different keys
+    Key first(named.getId(), new String("first"));
+    Key second(named.getId(), new String("second"));
+    GT_TRUE(!first.equals(&second));
+    GT_TRUE(first.equals(&forgotten));
+
+    delete read;
+    exit(0);
+}
+
+void testCodec() {
+    // A chunk of small ints, laid out the way Element columns serialize them
+    const size_t elements = 4096;
+    Serializer s;
+    s.write((uint64_t)elements);
+    for (size_t i = 0; i < elements; i++) {
+        Element element;
+        element.ptr = nullptr;
+        element.i = (int)(i % 100);
+        s._write((const char*)&element, sizeof(Element));
+    }
+
+    size_t compressedLength;
+    char* compressed = Codec::compress(s.getBuffer(), s.getSize(), sizeof(Element), compressedLength);
+    GT_TRUE(compressed != nullptr);
+    GT_TRUE(compressedLength < s.getSize() / 4);
+    GT_TRUE(Codec::decompressedLength(compressed) == s.getSize());
+
+    size_t length;
+    char* decompressed = Codec::decompress(compressed, compressedLength, length);
+    GT_TRUE(length == s.getSize());
+    GT_TRUE(!memcmp(decompressed, s.getBuffer(), length));
+    delete[] compressed;
+    delete[] decompressed;
+
+    // Bytes that do not repeat are not compressed
+    char noise[1000];
+    uint64_t state = 1;
+    for (size_t i = 0; i < sizeof(noise); i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        noise[i] = (char)(state >> 56);
+    }
+    GT_TRUE(Codec::compress(noise, sizeof(noise), 1, compressedLength) == nullptr);
+
+    // Odd lengths keep their trailing bytes through the shuffle
+    const char* text = "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabc";
+    compressed = Codec::compress(text, strlen(text), sizeof(Element), compressedLength);
+    GT_TRUE(compressed != nullptr);
+    decompressed = Codec::decompress(compressed, compressedLength, length);
+    GT_TRUE(length == strlen(text) && !memcmp(decompressed, text, length));
+    delete[] compressed;
+    delete[] decompressed;
+
+    exit(0);
+}
+
+void testWorkers() {
+    std::atomic<size_t> running(0);
+    std::atomic<size_t> mostRunning(0);
+    std::atomic<size_t> finished(0);
+
+    {
+        Workers workers(3);
+        for (size_t i = 0; i < 50; i++) {
+            workers.submit([&] {
+                size_t now = ++running;
+                size_t most = mostRunning;
+                while (now > most && !mostRunning.compare_exchange_weak(most, now)) {}
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                running--;
+                finished++;
+            });
+        }
+
+        workers.wait();
+        GT_TRUE(finished == 50);
+
+        // Workers can be reused after waiting
+        workers.submit([&] { finished++; });
+    }
+
+    GT_TRUE(finished == 51);
+    GT_TRUE(mostRunning <= 3);
+
+    exit(0);
+}
+
+TEST(W2, testChunkKeys) { ASSERT_EXIT_ZERO(testChunkKeys) }
+TEST(W2, testDataframeDescriptions) { ASSERT_EXIT_ZERO(testDataframeDescriptions) }
+TEST(W2, testConsistentHashPlacementIsBalanced) { ASSERT_EXIT_ZERO(testConsistentHashPlacementIsBalanced) }
+TEST(W2, testConsistentHashPlacementMovesLittle) { ASSERT_EXIT_ZERO(testConsistentHashPlacementMovesLittle) }
+TEST(W2, testConsistentHashPlacementReplicas) { ASSERT_EXIT_ZERO(testConsistentHashPlacementReplicas) }
+TEST(W2, testKeyIds) { ASSERT_EXIT_ZERO(testKeyIds) }
+TEST(W2, testCodec) { ASSERT_EXIT_ZERO(testCodec) }
+TEST(W2, testWorkers) { ASSERT_EXIT_ZERO(testWorkers) }